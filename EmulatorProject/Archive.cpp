@@ -0,0 +1,610 @@
+#include "Archive.h"
+#include <windows.h>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <mutex>
+#include <map>
+
+static U16 Read16(const U8* p)
+{
+	return (U16)(p[0] | (p[1] << 8));
+}
+
+static U32 Read32(const U8* p)
+{
+	return (U32)p[0] | ((U32)p[1] << 8) | ((U32)p[2] << 16) | ((U32)p[3] << 24);
+}
+
+static U32 Crc32(const U8* data, size_t size)
+{
+	static U32 table[256];
+	static once_flag built;
+	call_once(built, []()
+	{
+		for (U32 n = 0; n < 256; n++)
+		{
+			U32 c = n;
+			for (int k = 0; k < 8; k++)
+			{
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			}
+			table[n] = c;
+		}
+	});
+	U32 crc = 0xFFFFFFFF;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFF;
+}
+
+////////////inflate (rfc 1951), enough for the deflate members in zip files
+
+struct Inflater
+{
+	const U8* m_In;
+	size_t m_InSize;
+	size_t m_InPos;
+	U32 m_BitBuffer;
+	int m_BitCount;
+	bool m_Error;
+	vector<U8>& m_Out;
+	size_t m_Limit; //more output than this means the header lied, the rest is not unpacked
+
+	Inflater(const U8* in, size_t size, vector<U8>& out, size_t limit)
+		: m_In(in), m_InSize(size), m_InPos(0), m_BitBuffer(0), m_BitCount(0), m_Error(false), m_Out(out), m_Limit(limit) {};
+
+	//canonical huffman table, amount of codes per length and the symbols ordered by code
+	struct Huffman
+	{
+		short m_Count[16];
+		short m_Symbol[288];
+	};
+
+	int Bits(int need)
+	{
+		U32 value = m_BitBuffer;
+		while (m_BitCount < need)
+		{
+			if (m_InPos >= m_InSize)
+			{
+				m_Error = true;
+				return 0;
+			}
+			value |= (U32)m_In[m_InPos++] << m_BitCount;
+			m_BitCount += 8;
+		}
+		m_BitBuffer = value >> need;
+		m_BitCount -= need;
+		return (int)(value & ((1UL << need) - 1));
+	}
+
+	int Decode(const Huffman& huffman)
+	{
+		int code = 0;
+		int first = 0;
+		int index = 0;
+		for (int length = 1; length < 16; length++)
+		{
+			code |= Bits(1);
+			int count = huffman.m_Count[length];
+			if (code - count < first)
+			{
+				return huffman.m_Symbol[index + (code - first)];
+			}
+			index += count;
+			first += count;
+			first <<= 1;
+			code <<= 1;
+		}
+		m_Error = true;
+		return -1;
+	}
+
+	//returns 0 for a complete code, above 0 for an incomplete one and below 0 for an oversubscribed one
+	static int Construct(Huffman& huffman, const short* lengths, int n)
+	{
+		fill(huffman.m_Count, huffman.m_Count + 16, (short)0);
+		for (int symbol = 0; symbol < n; symbol++)
+		{
+			huffman.m_Count[lengths[symbol]]++;
+		}
+		if (huffman.m_Count[0] == n)
+		{
+			return 0;
+		}
+
+		int left = 1;
+		for (int length = 1; length < 16; length++)
+		{
+			left <<= 1;
+			left -= huffman.m_Count[length];
+			if (left < 0)
+			{
+				return left;
+			}
+		}
+
+		short offsets[16];
+		offsets[1] = 0;
+		for (int length = 1; length < 15; length++)
+		{
+			offsets[length + 1] = offsets[length] + huffman.m_Count[length];
+		}
+		for (int symbol = 0; symbol < n; symbol++)
+		{
+			if (lengths[symbol] != 0)
+			{
+				huffman.m_Symbol[offsets[lengths[symbol]]++] = (short)symbol;
+			}
+		}
+		return left;
+	}
+
+	bool Stored()
+	{
+		//stored blocks start on a byte boundary
+		m_BitBuffer = 0;
+		m_BitCount = 0;
+		if (m_InPos + 4 > m_InSize)
+		{
+			return false;
+		}
+		U16 length = Read16(m_In + m_InPos);
+		U16 inverse = Read16(m_In + m_InPos + 2);
+		m_InPos += 4;
+		if (length != (U16)~inverse || m_InPos + length > m_InSize || m_Out.size() + length > m_Limit)
+		{
+			return false;
+		}
+		m_Out.insert(m_Out.end(), m_In + m_InPos, m_In + m_InPos + length);
+		m_InPos += length;
+		return true;
+	}
+
+	bool Codes(const Huffman& lengthcode, const Huffman& distancecode)
+	{
+		static const short lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+			35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static const short lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+			3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static const short distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+			257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		static const short distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+			7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		while (!m_Error)
+		{
+			int symbol = Decode(lengthcode);
+			if (symbol < 0)
+			{
+				return false;
+			}
+			if (symbol < 256)
+			{
+				if (m_Out.size() >= m_Limit)
+				{
+					return false;
+				}
+				m_Out.push_back((U8)symbol);
+			}
+			else if (symbol == 256)
+			{
+				return true;
+			}
+			else
+			{
+				symbol -= 257;
+				if (symbol >= 29)
+				{
+					return false;
+				}
+				int length = lengthBase[symbol] + Bits(lengthExtra[symbol]);
+				symbol = Decode(distancecode);
+				if (symbol < 0 || symbol >= 30)
+				{
+					return false;
+				}
+				size_t distance = distanceBase[symbol] + Bits(distanceExtra[symbol]);
+				if (distance > m_Out.size() || m_Out.size() + length > m_Limit)
+				{
+					return false;
+				}
+				//byte by byte on purpose, a match can overlap what it is copying
+				size_t from = m_Out.size() - distance;
+				for (int i = 0; i < length; i++)
+				{
+					m_Out.push_back(m_Out[from + i]);
+				}
+			}
+		}
+		return false;
+	}
+
+	bool Fixed()
+	{
+		static Huffman lengthcode;
+		static Huffman distancecode;
+		static once_flag built;
+		call_once(built, []()
+		{
+			short lengths[288];
+			int symbol = 0;
+			for (; symbol < 144; symbol++) lengths[symbol] = 8;
+			for (; symbol < 256; symbol++) lengths[symbol] = 9;
+			for (; symbol < 280; symbol++) lengths[symbol] = 7;
+			for (; symbol < 288; symbol++) lengths[symbol] = 8;
+			Construct(lengthcode, lengths, 288);
+			for (symbol = 0; symbol < 30; symbol++) lengths[symbol] = 5;
+			Construct(distancecode, lengths, 30);
+		});
+		return Codes(lengthcode, distancecode);
+	}
+
+	bool Dynamic()
+	{
+		static const short order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		short lengths[320];
+		Huffman lengthcode;
+		Huffman distancecode;
+
+		int lengthCount = Bits(5) + 257;
+		int distanceCount = Bits(5) + 1;
+		int codeCount = Bits(4) + 4;
+		if (m_Error || lengthCount > 286 || distanceCount > 30)
+		{
+			return false;
+		}
+
+		//the code lengths of the code lengths
+		int index = 0;
+		for (; index < codeCount; index++)
+		{
+			lengths[order[index]] = (short)Bits(3);
+		}
+		for (; index < 19; index++)
+		{
+			lengths[order[index]] = 0;
+		}
+		if (Construct(lengthcode, lengths, 19) != 0)
+		{
+			return false;
+		}
+
+		index = 0;
+		while (index < lengthCount + distanceCount && !m_Error)
+		{
+			int symbol = Decode(lengthcode);
+			if (symbol < 0)
+			{
+				return false;
+			}
+			if (symbol < 16)
+			{
+				lengths[index++] = (short)symbol;
+				continue;
+			}
+			short length = 0;
+			if (symbol == 16)
+			{
+				if (index == 0)
+				{
+					return false;
+				}
+				length = lengths[index - 1];
+				symbol = 3 + Bits(2);
+			}
+			else if (symbol == 17)
+			{
+				symbol = 3 + Bits(3);
+			}
+			else
+			{
+				symbol = 11 + Bits(7);
+			}
+			if (index + symbol > lengthCount + distanceCount)
+			{
+				return false;
+			}
+			while (symbol--)
+			{
+				lengths[index++] = length;
+			}
+		}
+		if (m_Error || lengths[256] == 0)
+		{
+			return false;
+		}
+
+		//incomplete codes are only allowed when there is a single code
+		int left = Construct(lengthcode, lengths, lengthCount);
+		if (left < 0 || (left > 0 && lengthCount - lengthcode.m_Count[0] != 1))
+		{
+			return false;
+		}
+		left = Construct(distancecode, lengths + lengthCount, distanceCount);
+		if (left < 0 || (left > 0 && distanceCount - distancecode.m_Count[0] != 1))
+		{
+			return false;
+		}
+		return Codes(lengthcode, distancecode);
+	}
+
+	bool Run()
+	{
+		int last;
+		do
+		{
+			last = Bits(1);
+			int type = Bits(2);
+			bool ok = false;
+			if (m_Error)
+			{
+				return false;
+			}
+			switch (type)
+			{
+			case 0: ok = Stored(); break;
+			case 1: ok = Fixed(); break;
+			case 2: ok = Dynamic(); break;
+			default: break;
+			}
+			if (!ok || m_Error)
+			{
+				return false;
+			}
+		} while (!last);
+		return true;
+	}
+};
+
+////////////archive
+
+Archive::~Archive()
+{
+	if (m_Data != nullptr)
+	{
+		UnmapViewOfFile(m_Data);
+	}
+	if (m_Mapping != nullptr)
+	{
+		CloseHandle(m_Mapping);
+	}
+	if (m_File != nullptr)
+	{
+		CloseHandle(m_File);
+	}
+}
+
+shared_ptr<Archive> Archive::Open(const string& path)
+{
+	//every archive is indexed once per run and stays mapped
+	static mutex lock;
+	static map<string, shared_ptr<Archive>> opened;
+	lock_guard<mutex> guard(lock);
+	map<string, shared_ptr<Archive>>::iterator found = opened.find(path);
+	if (found != opened.end())
+	{
+		return found->second;
+	}
+
+	shared_ptr<Archive> archive(new Archive());
+	string lower = path;
+	transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+	archive->m_Zip = lower.size() > 4 && lower.compare(lower.size() - 4, 4, ".zip") == 0;
+	if (!archive->Map(path) || !(archive->m_Zip ? archive->ParseZip() : archive->ParseTar()))
+	{
+		archive.reset();
+	}
+	opened[path] = archive;
+	return archive;
+}
+
+bool Archive::IsArchive(const string& path)
+{
+	string lower = path;
+	transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+	return lower.size() > 4 && (lower.compare(lower.size() - 4, 4, ".zip") == 0 || lower.compare(lower.size() - 4, 4, ".tar") == 0);
+}
+
+bool Archive::SplitPath(const string& path, string& archive, string& member)
+{
+	//the colon after the extension, not the one of a drive letter
+	string lower = path;
+	transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+	size_t split = lower.find(".zip:");
+	if (split == string::npos)
+	{
+		split = lower.find(".tar:");
+	}
+	if (split == string::npos)
+	{
+		return false;
+	}
+	archive = path.substr(0, split + 4);
+	member = path.substr(split + 5);
+	replace(member.begin(), member.end(), '\\', '/');
+	return !member.empty();
+}
+
+bool Archive::Map(const string& path)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	m_File = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		return false;
+	}
+	m_Size = (size_t)size.QuadPart;
+
+	m_Mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_Mapping == NULL)
+	{
+		return false;
+	}
+	m_Data = (const U8*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+	return m_Data != nullptr;
+}
+
+bool Archive::ParseZip()
+{
+	//the end of central directory record is in the last 64 KB, behind an optional comment
+	const U32 END_SIGNATURE = 0x06054b50;
+	const U32 CENTRAL_SIGNATURE = 0x02014b50;
+	if (m_Size < 22)
+	{
+		return false;
+	}
+	size_t end = m_Size - 22;
+	size_t stop = m_Size > 22 + 0xFFFF ? m_Size - 22 - 0xFFFF : 0;
+	while (Read32(m_Data + end) != END_SIGNATURE)
+	{
+		if (end == stop)
+		{
+			return false;
+		}
+		--end;
+	}
+
+	U16 count = Read16(m_Data + end + 10);
+	size_t offset = Read32(m_Data + end + 16);
+	for (U16 i = 0; i < count; i++)
+	{
+		if (offset + 46 > m_Size || Read32(m_Data + offset) != CENTRAL_SIGNATURE)
+		{
+			return false;
+		}
+		const U8* header = m_Data + offset;
+		U16 nameLength = Read16(header + 28);
+		U16 extraLength = Read16(header + 30);
+		U16 commentLength = Read16(header + 32);
+		if (offset + 46 + nameLength > m_Size)
+		{
+			return false;
+		}
+
+		string name((const char*)header + 46, nameLength);
+		if (!name.empty() && name.back() != '/')
+		{
+			Member member;
+			member.m_Method = Read16(header + 10);
+			member.m_StoredSize = Read32(header + 20);
+			member.m_Size = Read32(header + 24);
+			member.m_Offset = Read32(header + 42);
+			member.m_HasCrc = true;
+			member.m_Crc = Read32(header + 16);
+			m_Members[name] = member;
+		}
+		offset += 46 + nameLength + extraLength + commentLength;
+	}
+	return true;
+}
+
+bool Archive::ParseTar()
+{
+	//512 byte headers, each followed by the data padded to 512 bytes
+	size_t offset = 0;
+	while (offset + 512 <= m_Size)
+	{
+		const U8* header = m_Data + offset;
+		if (header[0] == 0)
+		{
+			break; //the two empty blocks at the end
+		}
+
+		string name((const char*)header, strnlen((const char*)header, 100));
+		if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != 0)
+		{
+			name = string((const char*)header + 345, strnlen((const char*)header + 345, 155)) + "/" + name;
+		}
+		size_t size = strtoul(string((const char*)header + 124, 12).c_str(), nullptr, 8);
+		char type = (char)header[156];
+		if (offset + 512 + size > m_Size)
+		{
+			return false;
+		}
+
+		if (type == '0' || type == 0)
+		{
+			Member member;
+			member.m_Method = 0;
+			member.m_StoredSize = size;
+			member.m_Size = size;
+			member.m_Offset = offset + 512;
+			member.m_HasCrc = false;
+			member.m_Crc = 0;
+			m_Members[name] = member;
+		}
+		offset += 512 + ((size + 511) / 512) * 512;
+	}
+	return true;
+}
+
+vector<string> Archive::Members() const
+{
+	vector<string> names;
+	for (const pair<const string, Member>& member : m_Members)
+	{
+		names.push_back(member.first);
+	}
+	sort(names.begin(), names.end());
+	return names;
+}
+
+bool Archive::Read(const string& name, vector<U8>& data) const
+{
+	unordered_map<string, Member>::const_iterator found = m_Members.find(name);
+	if (found == m_Members.end())
+	{
+		return false;
+	}
+	const Member& member = found->second;
+	//nothing bigger fits in chip8 memory, the sizes come from the archive and are not trusted further than that
+	if (member.m_Size > Chip8::MAX_ROMSIZE || (member.m_Method == 0 && member.m_StoredSize != member.m_Size))
+	{
+		return false;
+	}
+
+	size_t offset = member.m_Offset;
+	if (m_Zip)
+	{
+		//zip members start with a local header whose extra field can differ from the central one
+		if (offset + 30 > m_Size || Read32(m_Data + offset) != 0x04034b50)
+		{
+			return false;
+		}
+		offset += 30 + Read16(m_Data + offset + 26) + Read16(m_Data + offset + 28);
+	}
+	if (offset + member.m_StoredSize > m_Size)
+	{
+		return false;
+	}
+
+	data.clear();
+	if (member.m_Method == 0)
+	{
+		data.assign(m_Data + offset, m_Data + offset + member.m_StoredSize);
+	}
+	else if (member.m_Method == 8)
+	{
+		data.reserve(member.m_Size);
+		Inflater inflater(m_Data + offset, member.m_StoredSize, data, member.m_Size);
+		if (!inflater.Run() || data.size() != member.m_Size)
+		{
+			return false;
+		}
+	}
+	else
+	{
+		return false;
+	}
+	return !member.m_HasCrc || Crc32(data.data(), data.size()) == member.m_Crc;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "Chip8.h"
+
+using namespace std;
+
+//a zip or tar file mapped into memory, its member list is read once and members are
+//unpacked only when asked for, so a whole rom pack costs one open instead of one per rom
+class Archive
+{
+public:
+	~Archive();
+
+	//the archive at this path, opened and indexed on first use and shared after that
+	static shared_ptr<Archive> Open(const string& path);
+	//splits "pack.zip:Games/Pong.ch8" in the archive and member part, false for a normal file
+	static bool SplitPath(const string& path, string& archive, string& member);
+	//true for paths ending in .zip or .tar
+	static bool IsArchive(const string& path);
+
+	bool Read(const string& member, vector<U8>& data) const;
+	vector<string> Members() const;
+
+private:
+	struct Member
+	{
+		size_t m_Offset;		//of the local header for zip, of the data for tar
+		size_t m_StoredSize;
+		size_t m_Size;
+		U16 m_Method;			//0 stored, 8 deflate
+		bool m_HasCrc;			//zip members carry a crc32 of the unpacked data, tar members do not
+		U32 m_Crc;
+	};
+
+	Archive() {};
+	bool Map(const string& path);
+	bool ParseZip();
+	bool ParseTar();
+
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+	const U8* m_Data = nullptr;
+	size_t m_Size = 0;
+	bool m_Zip = false;
+	unordered_map<string, Member> m_Members;
+};
@@ -1,10 +1,20 @@
 #include "Chip8.h"
+#include "Opcodes.h"
+#ifndef CHIP8_HEADLESS
 #include <windows.h>
 #include <GLFW/glfw3.h>
 #include "Logger.h"
+#include "Archive.h"
+#endif
 #include <sstream>
+#include <iomanip>
+#include <iterator>
 #include <thread>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
 
+#ifndef CHIP8_HEADLESS
 //layout "x123qweasdzc4rfv"
 const int Chip8::KeyBoardLayout[AMOUNT_OF_KEYS] =
 {
@@ -13,6 +23,7 @@ const int Chip8::KeyBoardLayout[AMOUNT_OF_KEYS] =
 	GLFW_KEY_S, /*8*/	GLFW_KEY_D, /*9*/	GLFW_KEY_Z, /*A*/	GLFW_KEY_C, /*B*/
 	GLFW_KEY_4, /*C*/	GLFW_KEY_R, /*D*/	GLFW_KEY_F, /*E*/	GLFW_KEY_V  /*F*/
 };
+#endif
 
 const unsigned char Chip8::chip8_fontset[80] =
 {
@@ -29,13 +40,33 @@ const unsigned char Chip8::chip8_fontset[80] =
 	0xF0, 0x80, 0xF0, 0x80, 0xF0, /*E*/	0xF0, 0x80, 0xF0, 0x80, 0x80  /*F*/
 };
 
-bool Chip8::LoadGame(string path)
+//super-chip 8x10 digits for FX30, with the xo-chip letters A-F
+const unsigned char Chip8::chip8_bigfontset[160] =
 {
-	m_Path = path;
+	0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, /*0*/
+	0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, /*1*/
+	0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, /*2*/
+	0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, /*3*/
+	0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, /*4*/
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, /*5*/
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, /*6*/
+	0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, /*7*/
+	0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, /*8*/
+	0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, /*9*/
+	0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, /*A*/
+	0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, /*B*/
+	0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, /*C*/
+	0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, /*D*/
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, /*E*/
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  /*F*/
+};
 
+void Chip8::Reset()
+{
 	//reset memory
-	m_Memory.empty();
-	m_Stack.empty();
+	m_Memory.fill(0);
+	m_Stack.fill(0);
+	m_StackPointer = 0;
 
 	//reset timers
 	m_SoundTimer = 0;
@@ -46,17 +77,19 @@ bool Chip8::LoadGame(string path)
 
 	m_IndexRegister = 0;
 
-	//load fontset
+	//load fontset, the big font follows the small one
 	for (size_t i = 0; i < 80; i++)
 	{
 		m_Memory[i] = chip8_fontset[i];
 	}
-
-	//clear the entire screen (hires included)
-	for (size_t i = 0; i < 64 * 64; i++)
+	for (size_t i = 0; i < 160; i++)
 	{
-		m_ScreenBuffer[i] = 0;
+		m_Memory[BIGFONT_STARTPOS + i] = chip8_bigfontset[i];
 	}
+	m_MemoryTop = PROGRAM_STARTPOS;
+
+	//clear the entire screen, every plane and mode included
+	m_ScreenBuffer.fill(0);
 
 	//clear the registers
 	for (size_t i = 0; i < 16; i++)
@@ -64,427 +97,518 @@ bool Chip8::LoadGame(string path)
 		m_Registers[i] = 0;
 	}
 
-	//open file in binary read mode
-	ifstream t;
-	t.open(path.c_str(),ifstream::in | ifstream::binary);
-
-	//start in non hires mode
+	//start in non hires mode, drawing on the first plane
 	hiresmode = false;
+	m_ExtendedMode = false;
+	m_Planes = 1;
+	m_Flags.fill(0);
+	m_AudioPattern.fill(0);
+	m_Pitch = 64;
+	m_Random = (U32)rand();
+	MarkAllDirty();
+	RehashMemory();
+	RehashScreen();
 
 	//disable logging at the start
 	m_Log = false;
+	m_GameLoaded = false;
+	m_Size = 0;
+}
 
-	//check if file exists
-	m_GameLoaded = t.good();
-	if (m_GameLoaded == false)
+bool Chip8::LoadRom(const U8* data, size_t size)
+{
+	//anything past the end of memory can never be loaded, the running game is left alone
+	if (size > MAX_ROMSIZE)
 	{
 		return false;
 	}
-	cout << endl << endl;
 
-	//counter
-	int i = 0;
-	do
+	Reset();
+
+	//m_Memory needs to be loaded in at location 200
+	for (size_t i = 0; i < size; i++)
 	{
-		int a = t.get();
-		if (a != 0xffffffff)
+		m_Memory[i + PROGRAM_STARTPOS] = data[i];
+	}
+	m_Size = (int)size;
+	m_MemoryTop = PROGRAM_STARTPOS + (int)size;
+	RehashMemory();
+	m_GameLoaded = true;
+	return true;
+}
+
+bool Chip8::LoadGame(string path)
+{
+	vector<U8> rom;
+#ifndef CHIP8_HEADLESS
+	//pack.zip:Games/Pong.ch8 is read from the already indexed archive
+	string archivepath;
+	string member;
+	if (Archive::SplitPath(path, archivepath, member))
+	{
+		shared_ptr<Archive> archive = Archive::Open(archivepath);
+		if (!archive || !archive->Read(member, rom))
 		{
-			//m_Memory needs to be loaded in at location 200
-			m_Memory[i + PROGRAM_STARTPOS] = a & 0xFF;
+			return false;
+		}
+	}
+	else
+#endif
+	{
+		//open file in binary read mode and read it in one go
+		ifstream t;
+		t.open(path.c_str(),ifstream::in | ifstream::binary);
 
-			//purely to write it pretty in command window
-			if (a < 10)
-			{
-				//numbers lower than 10 need to show the 0
-				cout << std::hex << "0" << a;
-			}
-			else
-			{
-				cout << std::hex << a;
-			}
+		//check if file exists, the machine is only touched once the rom is known to fit
+		if (!t.good())
+		{
+			return false;
+		}
+		rom.assign(istreambuf_iterator<char>(t), istreambuf_iterator<char>());
+	}
+	if (rom.size() > MAX_ROMSIZE)
+	{
+		return false;
+	}
+
+	//purely to write it pretty in command window, built up first and printed at once
+	if (!m_Muted)
+	{
+		std::stringstream dump;
+		dump << endl << endl << std::hex << std::setfill('0');
+		for (size_t i = 0; i < rom.size(); i++)
+		{
+			dump << std::setw(2) << (int)rom[i];
 			if (i % 2 == 1)
 			{
 				//after every opcodepart place a space for readability
-				cout << " ";
+				dump << " ";
 			}
 			if ((i + 2) % (6*2) == 1)
 			{
 				//devide in mulitple lines
-				cout << endl;
+				dump << endl;
 			}
-			++i;
 		}
-	} while (!t.eof());
-	//filesize
-	m_Size = i;
-	cout << endl << endl;
-	return m_GameLoaded;
+		dump << endl << endl;
+		cout << dump.str();
+	}
+
+	m_Path = path;
+	m_Rom = rom;
+	return LoadRom(m_Rom.data(), m_Rom.size());
 }
 
 bool Chip8::RunCommand(const U16 command)
 {
-	//F000 remove all but the first opcode part
-	int firstopcodepart = (command >> 12) & 0xF;
-	switch (firstopcodepart)
+	//the opcode table tells which instruction it is, the operands are the same bits for every instruction
+	U8 x = (command >> 8) & 0xF;
+	U8 y = (command >> 4) & 0xF;
+	U8 nn = command & 0xFF;
+	U16 nnn = command & 0xFFF;
+	int n = command & 0xF;
+	switch (Opcodes::Lookup(command))
 	{
-	case 0x0:
+	case Opcodes::CLS:
 	{
-		int lastOpcodePart = (command)& 0xFFF;
-		if (lastOpcodePart == 0x0E0)
-		{
-			///00E0 	Clears the screen.
-			for (size_t i = 0; i < 64 * 32; i++)
-			{
-				m_ScreenBuffer[i] = 0;
-			}
-		}
-		else if (lastOpcodePart == 0x0EE)
-		{
-			///00EE 	Returns from a subroutine.
-			m_ProgramCounter = m_Stack.back();
-			m_Stack.pop_back();
-		}
-		else if (lastOpcodePart == 0x230)
+		///00E0 	Clears the screen.
+		///0230 	hires command to clear the screen
+		ClearPlanes();
+	}break;
+
+	case Opcodes::RET:
+	{
+		///00EE 	Returns from a subroutine.
+		if (m_StackPointer == 0)
 		{
-			///hires command to cler the screen
-			for (size_t i = 0; i < 64 * 64; i++)
-			{
-				m_ScreenBuffer[i] = 0;
-			}
+			return false; //return without a call, treated as an unknown opcode
 		}
-		else
-		{return false;}
+		m_ProgramCounter = m_Stack[--m_StackPointer];
+	}break;
+
+	case Opcodes::SCD:
+	{
+		///00CN 	Scrolls the screen down N rows. (super-chip)
+		ScrollVertical(n);
+	}break;
+
+	case Opcodes::SCU:
+	{
+		///00DN 	Scrolls the screen up N rows. (xo-chip)
+		ScrollVertical(-n);
+	}break;
+
+	case Opcodes::SCR:
+	{
+		///00FB 	Scrolls the screen right 4 pixels. (super-chip)
+		ScrollHorizontal(4);
+	}break;
+
+	case Opcodes::SCL:
+	{
+		///00FC 	Scrolls the screen left 4 pixels. (super-chip)
+		ScrollHorizontal(-4);
+	}break;
+
+	case Opcodes::EXIT:
+	{
+		///00FD 	Exits the interpreter. (super-chip)
+		return false;
+	}
+
+	case Opcodes::LOW:
+	case Opcodes::HIGH:
+	{
+		///00FE/00FF 	Switches to 64x32 or 128x64 and clears the screen. (super-chip)
+		m_ExtendedMode = nnn == 0x0FF;
+		ClearScreen();
 	}break;
 
-	case 0x1:
+	case Opcodes::JP:
 	{
 		///1NNN 	Jumps to address NNN.
-		m_ProgramCounter = command & 0x0FFF;
+		///a rom that starts with 1260 is a 64x64 hires game, its code starts at 2C0
+		if (m_ProgramCounter == PROGRAM_STARTPOS && nnn == 0x260)
+		{
+			hiresmode = true;
+			nnn = 0x2C0;
+		}
+		m_ProgramCounter = nnn;
 		m_ProgramCounter -= 2; //dont do the automatic move forward
 	}break;
 
-	case 0x2:
+	case Opcodes::CALL:
 	{
 		///2NNN 	Calls subroutine at NNN.
-		m_Stack.push_back(m_ProgramCounter);
-		m_ProgramCounter = command & 0x0FFF;
+		if (m_StackPointer >= STACK_SIZE)
+		{
+			return false; //the stack only has room for 16 calls
+		}
+		m_Stack[m_StackPointer++] = m_ProgramCounter;
+		m_ProgramCounter = nnn;
 		m_ProgramCounter -= 2;
 	}break;
 
-	case 0x3:
+	case Opcodes::SE_VB:
 	{
 		///3XNN 	Skips the next instruction if VX equals NN.
-		U8 x = (command >> 8) & 0x0F;
-		U16 nn = (command & 0x00FF);
-		if ((int)m_Registers[x] == (int)nn)
+		if (m_Registers[x] == nn)
 		{
-			m_ProgramCounter += 2; //jump 1
+			SkipNext(); //jump 1
 		}
 	}break;
 
-	case 0x4:
+	case Opcodes::SNE_VB:
 	{
 		///4XNN 	Skips the next instruction if VX doesn't equal NN.
-		U8 x = (command >> 8) & 0x0F;
-		U16 nn = (command & 0x00FF);
-		if ((int)m_Registers[x] != (int)nn)
+		if (m_Registers[x] != nn)
 		{
-			m_ProgramCounter += 2;
+			SkipNext();
 		}
 	}break;
 
-	case 0x5:
+	case Opcodes::SE_VV:
 	{
 		///5XY0 	Skips the next instruction if VX equals VY.
-		U8 x = (command >> 8) & 0x0F;
-		U8 y = (command >> 4) & 0x0F;
-		if ((int)m_Registers[x] == (int)m_Registers[y])
+		if (m_Registers[x] == m_Registers[y])
+		{
+			SkipNext();
+		}
+	}break;
+
+	case Opcodes::SAVE_RANGE:
+	{
+		///5XY2 	Stores VX to VY in m_Memory starting at address I, I is left alone. (xo-chip)
+		int step = x <= y ? 1 : -1;
+		for (int i = 0; i <= abs(y - x); i++)
 		{
-			m_ProgramCounter += 2;
+			WriteMemory(m_IndexRegister + i, m_Registers[x + i * step]);
 		}
 	}break;
 
-	case 0x6:
+	case Opcodes::LOAD_RANGE:
+	{
+		///5XY3 	Fills VX to VY from m_Memory starting at address I, I is left alone. (xo-chip)
+		int step = x <= y ? 1 : -1;
+		for (int i = 0; i <= abs(y - x); i++)
+		{
+			m_Registers[x + i * step] = m_Memory[(m_IndexRegister + i) & 0xFFFF];
+		}
+	}break;
+
+	case Opcodes::LD_VB:
 	{
 		///6XNN 	Sets VX to NN.
-		U8 x = (command >> 8) & 0x0F;
-		U8 nn = (command)& 0x00FF;
 		m_Registers[x] = nn;
 	}break;
 
-	case 0x7:
+	case Opcodes::ADD_VB:
 	{
 		///7XNN 	Adds NN to VX.
-		U8 x = (command >> 8) & 0x0F;
-		U8 nn = (command)& 0x00FF;
 		m_Registers[x] += nn;
 	}break;
 
-	case 0x8:
+	case Opcodes::LD_VV:
 	{
-		U8 lastOpcodePart = (command & 0x000F);
-		U8 x = (command >> 8) & 0xF;
-		U8 y = (command >> 4) & 0xF;
+		///8XY0 	Sets VX to the value of VY.
+		m_Registers[x] = m_Registers[y];
+	}break;
 
-		switch (lastOpcodePart)
-		{
-			case 0x0:
-			{
-				///8XY0 	Sets VX to the value of VY.
-				m_Registers[x] = m_Registers[y];
-			}break;
+	case Opcodes::OR:
+	{
+		///8XY1 	Sets VX to VX or VY.
+		m_Registers[x] = m_Registers[x] | m_Registers[y];
+	}break;
 
-			case 0x1:
-			{
-				///8XY1 	Sets VX to VX or VY.
-				m_Registers[x] = m_Registers[x] | m_Registers[y];
-			}break;
+	case Opcodes::AND:
+	{
+		///8XY2 	Sets VX to VX and VY.
+		m_Registers[x] = m_Registers[x] & m_Registers[y];
+	}break;
 
-			case 0x2:
-			{
-				///8XY2 	Sets VX to VX and VY.
-				m_Registers[x] = m_Registers[x] & m_Registers[y];
-			}break;
+	case Opcodes::XOR:
+	{
+		///8XY3 	Sets VX to VX xor VY.
+		m_Registers[x] = m_Registers[x] ^ m_Registers[y];
+	}break;
 
-			case 0x3:
-			{
-				///8XY3 	Sets VX to VX xor VY.
-				m_Registers[x] = m_Registers[x] ^ m_Registers[y];
-			}break;
+	case Opcodes::ADD_VV:
+	{
+		///8XY4 	Adds VY to VX.VF is set to 1 when there's a carry, and to 0 when there isn't.
+		int result = m_Registers[x] + m_Registers[y];
+		m_Registers[x] = (U8)result;
+		if (result > 255)
+			m_Registers[0xF] = 1;
+		else
+			m_Registers[0xF] = 0;
+	}break;
 
-			case 0x4:
-			{
-				///8XY4 	Adds VY to VX.VF is set to 1 when there's a carry, and to 0 when there isn't.
-				int result = m_Registers[x] + m_Registers[y];
-				m_Registers[x] = (U8)result;
-				if (result > 255)
-					m_Registers[0xF] = 1;
-				else
-					m_Registers[0xF] = 0;
-			}break;
-
-			case 0x5:
-			{
-				///8XY5 	VY is subtracted from VX.VF is set to 0 when there's a borrow, and 1 when there isn't.
-				if (m_Registers[x] <  m_Registers[y])
-					m_Registers[0xF] = 0;
-				else										  
-					m_Registers[0xF] = 1;
+	case Opcodes::SUB:
+	{
+		///8XY5 	VY is subtracted from VX.VF is set to 0 when there's a borrow, and 1 when there isn't.
+		if (m_Registers[x] <  m_Registers[y])
+			m_Registers[0xF] = 0;
+		else
+			m_Registers[0xF] = 1;
 
-				m_Registers[x] -= m_Registers[y];
-			}break;
+		m_Registers[x] -= m_Registers[y];
+	}break;
 
-			case 0x6:
-			{
-				///8XY6 	Shifts VX right by one.VF is set to the value of the least significant bit of VX before the shift.[2]
-				m_Registers[0xF] = m_Registers[x] & 0xF;
-				m_Registers[x] = m_Registers[x] >> 1;
-			} break;
+	case Opcodes::SHR:
+	{
+		///8XY6 	Shifts VX right by one.VF is set to the value of the least significant bit of VX before the shift.[2]
+		m_Registers[0xF] = m_Registers[x] & 0xF;
+		m_Registers[x] = m_Registers[x] >> 1;
+	} break;
 
-			case 0x7:
-			{
-				///8XY7 	Sets VX to VY minus VX.VF is set to 0 when there's a borrow, and 1 when there isn't.
-				if (m_Registers[y] <  m_Registers[x])
-					m_Registers[0xF] = 0;
-				else
-					m_Registers[0xF] = 1;
-				m_Registers[x] -= m_Registers[y];
-			} break;
-
-			case 0xE:
-			{
-				///8XYE 	Shifts VX left by one.VF is set to the value of the most significant bit of VX before the shift.[2]
-				m_Registers[0xF] = (m_Registers[x]  >> 7) & 0xF;
-				m_Registers[x] = m_Registers[x] << 1;
-			} break;
+	case Opcodes::SUBN:
+	{
+		///8XY7 	Sets VX to VY minus VX.VF is set to 0 when there's a borrow, and 1 when there isn't.
+		if (m_Registers[y] <  m_Registers[x])
+			m_Registers[0xF] = 0;
+		else
+			m_Registers[0xF] = 1;
+		m_Registers[x] -= m_Registers[y];
+	} break;
 
-		default: return false;	break;
-		}
-	}break;
+	case Opcodes::SHL:
+	{
+		///8XYE 	Shifts VX left by one.VF is set to the value of the most significant bit of VX before the shift.[2]
+		m_Registers[0xF] = (m_Registers[x]  >> 7) & 0xF;
+		m_Registers[x] = m_Registers[x] << 1;
+	} break;
 
-	case 0x9:
+	case Opcodes::SNE_VV:
 	{
 		///9XY0 	Skips the next instruction if VX doesn't equal VY.
-		U8 x = (command >> 8) & 0xF;
-		U8 y = (command >> 4) & 0xF;
-
-		if ((int)m_Registers[x] != (int)m_Registers[y])
+		if (m_Registers[x] != m_Registers[y])
 		{
-			m_ProgramCounter += 2;
+			SkipNext();
 		}
 	}break;
 
-	case 0xA:
+	case Opcodes::LD_I:
 	{
 		///ANNN 	Sets I to the address NNN.
-		m_IndexRegister = command & 0x0FFF;
+		m_IndexRegister = nnn;
 	}break;
 
-	case 0xB:
+	case Opcodes::JP_V0:
 	{
 		///BNNN 	Jumps to the address NNN plus V0.
-		m_ProgramCounter = (command & 0x0FFF) + m_Registers[0];
+		m_ProgramCounter = nnn + m_Registers[0];
 		m_ProgramCounter -= 2;
 	}break;
 
-	case 0xC:
+	case Opcodes::RND:
 	{
 		///CXNN 	Sets VX to the result of a bitwise and operation on a random number and NN.
-		U8 x = (command >> 8) & 0x0F;
-		U8 nn = (command & 0x00FF);
-		m_Registers[x] = (rand()%256) & nn;
+		m_Registers[x] = NextRandom() & nn;
 	}break;
 
-	case 0xD:
+	case Opcodes::DRW:
 	{
 		///DXYN 	Sprites stored in m_Memory at location in index register (I), 8bits wide. Wraps around the screen.
 		///If when drawn, clears a pixel, register VF is set to 1 otherwise it is zero.
 		///All drawing is XOR drawing (i.e. it toggles the screen pixels).
 		///Sprites are drawn starting at position VX, VY. N is the number of 8bit rows that need to be drawn. If N is greater than 1,
 		///second line continues at position VX, VY+1, and so on.
-		//get postition and height of the sprite
-		U8 x = m_Registers[(command >> 8) & 0x0F];
-		U8 y = m_Registers[(command >> 4) & 0x00F];
-		int rows = command & 0x000F;
-		U16 pixel;
-
-		//reset the drawflag
-		m_Registers[0xF] = 0;
-		for (int yline = 0; yline < rows; ++yline)
-		{
-			//Sprites stored in m_Memory at location in index register (I), 8bits wide
-			pixel = m_Memory[m_IndexRegister + yline];
-			for (int xline = 0; xline < 8; ++xline)
-			{
-				if ((pixel & (0x80 >> xline)) != 0)
-				{
-					int temp = (((x + xline)) + (((y + yline)) * 64));
-					bool result = false;
-					if (hiresmode)
-					{
-						result = (temp %= m_ScreenBuffer.size());
-					}
-					else
-					{
-						result = (temp %= m_ScreenBuffer.size()/2);
-					}
-					if (result)
-					{
-		 // If when drawn, clears a pixel, register VF is set to 1 otherwise it is zero
-						if (m_ScreenBuffer[temp] == 1)
-							m_Registers[0xF] = 1;
-						m_ScreenBuffer[temp] ^= 1;
-					}
-				}
-			}
+		///DXY0 	draws a 16x16 sprite instead. (super-chip)
+		///with more than one plane selected the sprite data for each plane follows the previous one. (xo-chip)
+		bool collision = DrawSprite(m_Registers[x], m_Registers[y], n == 0 ? 16 : n, n == 0);
+		m_Registers[0xF] = collision ? 1 : 0;
+	}break;
+
+	case Opcodes::SKP:
+	{
+		///EX9E 	Skips the next instruction if the key stored in VX is pressed.
+		m_KeysRead |= 1 << (m_Registers[x] & 0xF);
+		if ((m_Keys >> (m_Registers[x] & 0xF)) & 1)
+		{
+			SkipNext();
 		}
 	}break;
 
-	case 0xE:
+	case Opcodes::SKNP:
 	{
-		int x = (command >> 8) & 0xF;
-		if ((command & 0xF0FF) == 0xE09E)
+		///EXA1 	Skips the next instruction if the key stored in VX isn't pressed.
+		m_KeysRead |= 1 << (m_Registers[x] & 0xF);
+		if (!((m_Keys >> (m_Registers[x] & 0xF)) & 1))
 		{
-			///EX9E 	Skips the next instruction if the key stored in VX is pressed.
-			if (glfwGetKey(m_WindowPtr, KeyBoardLayout[(int)m_Registers[x]]))
-			{
-				m_ProgramCounter += 2;
-			}
+			SkipNext();
 		}
-		else if ((command & 0xF0FF) == 0xE0A1)
+	}break;
+
+	case Opcodes::LD_I_LONG:
+	{
+		///F000 NNNN 	Sets I to the 16 bit address NNNN that follows the opcode. (xo-chip)
+		m_IndexRegister = m_Memory[(m_ProgramCounter + 2) & 0xFFFF] << 8 | m_Memory[(m_ProgramCounter + 3) & 0xFFFF];
+		m_ProgramCounter += 2;
+	}break;
+
+	case Opcodes::PLANE:
+	{
+		///FN01 	Selects the planes N that drawing, clearing and scrolling work on. (xo-chip)
+		m_Planes = x & 0x3;
+	}break;
+
+	case Opcodes::AUDIO:
+	{
+		///F002 	Loads the 16 byte audio pattern from m_Memory at address I. (xo-chip)
+		for (size_t i = 0; i < m_AudioPattern.size(); i++)
+		{
+			m_AudioPattern[i] = m_Memory[(m_IndexRegister + i) & 0xFFFF];
+		}
+	}break;
+
+	case Opcodes::LD_VDT:
+	{
+		///FX07 	Sets VX to the value of the delay timer.
+		m_Registers[x] = m_DelayTimer;
+	}break;
+
+	case Opcodes::LD_KEY:
+	{
+		///FX0A 	A key press is awaited, and then stored in VX.
+		m_KeysRead |= m_Keys;
+		m_ProgramCounter -= 2;
+		for (size_t i = 0; i < AMOUNT_OF_KEYS; i++)
 		{
-			///EXA1 	Skips the next instruction if the key stored in VX isn't pressed.
-			if (!glfwGetKey(m_WindowPtr, KeyBoardLayout[(int)m_Registers[x]]))
+			if ((m_Keys >> i) & 1)
 			{
+				m_Registers[x] = i;
 				m_ProgramCounter += 2;
+				break;
 			}
 		}
-		else
-		{
-			return false;
-		}
 	}break;
 
-	case 0xF:
+	case Opcodes::LD_DT:
 	{
-		U8 lastopcodepart = command & 0xFF;
-		U8 x = (command >> 8) & 0xF;
+		///FX15 	Sets the delay timer to VX.
+		m_DelayTimer = m_Registers[x];
+	}break;
 
-		switch (lastopcodepart)
-		{
-		case 0x07:
+	case Opcodes::LD_ST:
+	{
+		///FX18 	Sets the sound timer to VX.
+		m_SoundTimer = m_Registers[x];
+	}break;
+
+	case Opcodes::ADD_I:
+	{
+		///FX1E 	Adds VX to I.[3]
+		m_IndexRegister += m_Registers[x];
+	}break;
+
+	case Opcodes::LD_F:
+	{
+		///FX29 	Sets I to the location of the sprite for the character in VX.Characters 0 - F(in hexadecimal) are represented by a 4x5 font.
+		m_IndexRegister = (m_Registers[x] * 5);
+	}break;
+
+	case Opcodes::LD_HF:
+	{
+		///FX30 	Sets I to the location of the 8x10 sprite for the character in VX. (super-chip)
+		m_IndexRegister = BIGFONT_STARTPOS + (m_Registers[x] & 0xF) * 10;
+	}break;
+
+	case Opcodes::PITCH:
+	{
+		///FX3A 	Sets the pitch the audio pattern plays at to VX. (xo-chip)
+		m_Pitch = m_Registers[x];
+	}break;
+
+	case Opcodes::BCD:
+	{
+		///FX33 	Stores the Binary - coded decimal representation of VX,
+		///with the most significant of three digits at the address in I,
+		///the middle digit at I plus 1, and the least significant digit at I plus 2.
+		///(In other words, take the decimal representation of VX,
+		///place the hundreds digit in m_Memory at location in I,
+		///the tens digit at location I + 1, and the ones digit at location I + 2.)
+		///addresses past the end of memory wrap around to 0
+		WriteMemory(m_IndexRegister, m_Registers[x] / 100); //honderttallen
+		WriteMemory(m_IndexRegister + 1, (m_Registers[x] / 10) % 10); //tientallen
+		WriteMemory(m_IndexRegister + 2, m_Registers[x] % 10); //eenheden
+	}break;
+
+	case Opcodes::STORE:
+	{
+		///FX55 	Stores V0 to VX in m_Memory starting at address I.[4]
+		for (size_t i = 0; i <= (size_t)x; i++)
 		{
-			///FX07 	Sets VX to the value of the delay timer.
-			m_Registers[x] = m_DelayTimer;
-		}break;
-		case 0x0A:
+			WriteMemory(m_IndexRegister + (int)i, m_Registers[i]);
+		}
+		m_IndexRegister += x + 1;
+	}break;
+
+	case Opcodes::LOAD:
+	{
+		///FX65 	Fills V0 to VX with values from m_Memory starting at address I.[4]
+		for (size_t i = 0; i <= (size_t)x; i++)
 		{
-			///FX0A 	A key press is awaited, and then stored in VX.
-			m_ProgramCounter -= 2;
-			for (size_t i = 0; i < AMOUNT_OF_KEYS; i++)
-			{
-				if (glfwGetKey(m_WindowPtr, KeyBoardLayout[i]))
-				{
-					m_Registers[x] = i;
-					m_ProgramCounter += 2;
-					break;
-				}
-			}
-		}break;
-		case 0x15:
-		{
-			///FX15 	Sets the delay timer to VX.
-			m_DelayTimer = m_Registers[x];
-		}break;
-		case 0x18:
-		{
-			///FX18 	Sets the sound timer to VX.
-			m_SoundTimer = m_Registers[x];
-		}break;
-		case 0x1E:
-		{
-			///FX1E 	Adds VX to I.[3]
-			m_IndexRegister += m_Registers[x];
-		}break;
-		case 0x29:
-		{
-			///FX29 	Sets I to the location of the sprite for the character in VX.Characters 0 - F(in hexadecimal) are represented by a 4x5 font.
-			m_IndexRegister = (m_Registers[x] * 5);
-		}break;
-		case 0x33:
-		{
-			///FX33 	Stores the Binary - coded decimal representation of VX,
-			///with the most significant of three digits at the address in I,
-			///the middle digit at I plus 1, and the least significant digit at I plus 2.
-			///(In other words, take the decimal representation of VX,
-			///place the hundreds digit in m_Memory at location in I,
-			///the tens digit at location I + 1, and the ones digit at location I + 2.)
-			m_Memory[m_IndexRegister] = m_Registers[x] / 100; //honderttallen
-			m_Memory[m_IndexRegister + 1] =
-				(m_Registers[x] - m_Memory[m_IndexRegister] * 100) / 10; //tientallen
-			m_Memory[m_IndexRegister + 2] =
-				(m_Registers[x] - m_Memory[m_IndexRegister] * 100 - m_Memory[m_IndexRegister + 1] * 10); //eenheden
-		}break;
-		case 0x55:
-		{
-			///FX55 	Stores V0 to VX in m_Memory starting at address I.[4]
-			for (size_t i = 0; i <= (size_t)x; i++)
-			{
-				m_Memory[m_IndexRegister + i] = m_Registers[i];
-			}
-			m_IndexRegister += x + 1;
-		}break;
-		case 0x65:
+			m_Registers[i] = m_Memory[(m_IndexRegister + i) & 0xFFFF];
+		}
+
+		m_IndexRegister += x + 1;
+	}break;
+
+	case Opcodes::SAVE_FLAGS:
+	{
+		///FX75 	Stores V0 to VX in the flag registers. (super-chip)
+		for (size_t i = 0; i <= (size_t)x; i++)
 		{
-			///FX65 	Fills V0 to VX with values from m_Memory starting at address I.[4]
-			for (size_t i = 0; i <= (size_t)x; i++)
-			{
-				m_Registers[i] = m_Memory[m_IndexRegister + i];
-			}
+			m_Flags[i] = m_Registers[i];
+		}
+	}break;
 
-			m_IndexRegister += x + 1;
-		}break;
-		default: return false;	break;
+	case Opcodes::LOAD_FLAGS:
+	{
+		///FX85 	Fills V0 to VX from the flag registers. (super-chip)
+		for (size_t i = 0; i <= (size_t)x; i++)
+		{
+			m_Registers[i] = m_Flags[i];
 		}
 	}break;
 
@@ -494,100 +618,549 @@ bool Chip8::RunCommand(const U16 command)
 	return true;
 }
 
+ExitReason Chip8::RunFor(int instructions, int& executed)
+{
+	executed = 0;
+	if (!m_GameLoaded)
+	{
+		return EXIT_FRAME;
+	}
+	//the opcode log is the only thing looked at per instruction, without it the loop skips it
+#ifndef CHIP8_HEADLESS
+	if (m_Log && !m_Muted)
+	{
+		return RunLoop<true>(instructions, executed);
+	}
+#endif
+	return RunLoop<false>(instructions, executed);
+}
+
+template<bool Logging>
+ExitReason Chip8::RunLoop(int instructions, int& executed)
+{
+	int end = m_Size + PROGRAM_STARTPOS;
+	//instructions whose timer steps are still owed, only FX07, FX15 and FX18 touch the timers
+	//so they are caught up before any FX opcode and at the end
+	int owed = 0;
+	ExitReason reason = EXIT_FRAME;
+	for (; executed < instructions; executed++)
+	{
+		U16 pc = m_ProgramCounter;
+		U16 opcode = NextOpcode();
+#ifndef CHIP8_HEADLESS
+		if (Logging)
+		{
+			Logger::getInstance()->LogOpcode(opcode);
+		}
+#endif
+		if ((opcode & 0xF000) == 0xF000)
+		{
+			StepTimers(owed);
+			owed = 0;
+		}
+		if (!RunCommand(opcode))
+		{
+			++executed;
+			reason = Opcodes::Lookup(opcode) == Opcodes::EXIT ? EXIT_STOPPED : EXIT_UNKNOWN_OPCODE;
+			break;
+		}
+		m_ProgramCounter += 2;
+		++owed;
+
+		if (m_ProgramCounter >= end)
+		{
+			++executed;
+			reason = EXIT_OUT_OF_RANGE;
+			break;
+		}
+		if (m_ProgramCounter == pc && ((opcode & 0xF0FF) == 0xF00A || (opcode & 0xF000) == 0x1000))
+		{
+			//FX0A without a key or a jump to itself, only the timers change until the keys do
+			owed += instructions - executed - 1;
+			executed = instructions;
+			reason = (opcode & 0xF000) == 0xF000 ? EXIT_WAITING_FOR_KEY : EXIT_FRAME;
+			break;
+		}
+	}
+	StepTimers(owed);
+	return reason;
+}
+
+void Chip8::StepTimers(int steps)
+{
+	if (m_DelayTimer > 0)
+	{
+		m_DelayTimer = (U8)max((int)m_DelayTimer - steps, 0);
+	}
+	if (m_SoundTimer > 0)
+	{
+		//the beep starts when the sound timer runs out
+		if (m_SoundTimer <= steps && !m_Muted)
+		{
+			BeepPlay(PatternFrequency());
+		}
+		m_SoundTimer = (U8)max((int)m_SoundTimer - steps, 0);
+	}
+}
+
 bool Chip8::GameLoop()
 {
-	if (m_GameLoaded)
+	int executed;
+	return !Stops(RunFor(1, executed));
+}
+
+#ifndef CHIP8_HEADLESS
+void Chip8::PollKeys()
+{
+	//read the keyboard once so every instruction of a frame sees the same keys
+	m_Keys = 0;
+	for (int i = 0; i < AMOUNT_OF_KEYS; i++)
 	{
-		//get the opcode
-		U16 opcode = m_Memory[m_ProgramCounter] << 8 | m_Memory[m_ProgramCounter + 1];
-		//check if were dealing with a hires game
-		if ((m_ProgramCounter == 0x200) && (opcode == 0x1260))
+		if (glfwGetKey(m_WindowPtr, KeyBoardLayout[i]))
 		{
-			hiresmode = true; // Init 64x64 hires mode
-			opcode = 0x12C0;  // Make the interperter jump to address 0x2c0
+			m_Keys |= 1 << i;
 		}
+	}
 
+	if (!m_Muted)
+	{
 		if (glfwGetKey(m_WindowPtr, GLFW_KEY_O))
 		{
-			LoadGame(m_Path); // reset the game
+			LoadRom(m_Rom.data(), m_Rom.size()); // reset the game
 		}
 
 		if (glfwGetKey(m_WindowPtr, GLFW_KEY_P))
 		{
 			m_Log = !m_Log; // enable/disable logging
 		}
+	}
+}
+#endif
+
+void Chip8::SaveState(Chip8State& state) const
+{
+	state.m_Memory.assign(m_Memory.begin(), m_Memory.begin() + m_MemoryTop);
+	state.m_ScreenBuffer = m_ScreenBuffer;
+	SaveContext(state.m_Context);
+}
+
+void Chip8::LoadState(const Chip8State& state)
+{
+	//everything past the saved part was still 0 when the state was taken
+	copy(state.m_Memory.begin(), state.m_Memory.end(), m_Memory.begin());
+	if (m_MemoryTop > (int)state.m_Memory.size())
+	{
+		fill(m_Memory.begin() + state.m_Memory.size(), m_Memory.begin() + m_MemoryTop, 0);
+	}
+	m_MemoryTop = (int)state.m_Memory.size();
+	m_ScreenBuffer = state.m_ScreenBuffer;
+	LoadContext(state.m_Context);
+	MarkAllDirty();
+	RehashMemory();
+	RehashScreen();
+}
+
+void Chip8::SaveContext(Chip8Context& context) const
+{
+	context.m_Registers = m_Registers;
+	context.m_IndexRegister = m_IndexRegister;
+	context.m_ProgramCounter = m_ProgramCounter;
+	context.m_Stack = m_Stack;
+	context.m_StackPointer = m_StackPointer;
+	context.m_DelayTimer = m_DelayTimer;
+	context.m_SoundTimer = m_SoundTimer;
+	context.hiresmode = hiresmode;
+	context.m_ExtendedMode = m_ExtendedMode;
+	context.m_Planes = m_Planes;
+	context.m_Flags = m_Flags;
+	context.m_AudioPattern = m_AudioPattern;
+	context.m_Pitch = m_Pitch;
+	context.m_Random = m_Random;
+}
+
+void Chip8::LoadContext(const Chip8Context& context)
+{
+	m_Registers = context.m_Registers;
+	m_IndexRegister = context.m_IndexRegister;
+	m_ProgramCounter = context.m_ProgramCounter;
+	m_Stack = context.m_Stack;
+	m_StackPointer = context.m_StackPointer;
+	m_DelayTimer = context.m_DelayTimer;
+	m_SoundTimer = context.m_SoundTimer;
+	hiresmode = context.hiresmode;
+	m_ExtendedMode = context.m_ExtendedMode;
+	m_Planes = context.m_Planes;
+	m_Flags = context.m_Flags;
+	m_AudioPattern = context.m_AudioPattern;
+	m_Pitch = context.m_Pitch;
+	m_Random = context.m_Random;
+}
+
+void Chip8::MarkAllDirty()
+{
+	//written in one go, nothing can be shared with the fork the machine came from
+	m_DirtyMemory.fill(~0ULL);
+	m_DirtyScreen = 0xFF;
+}
+
+U16 Chip8::NextOpcode() const
+{
+	return m_Memory[m_ProgramCounter] << 8 | m_Memory[(m_ProgramCounter + 1) & 0xFFFF];
+}
+
+bool Chip8::ReadsKeys() const
+{
+	//EX9E, EXA1 and FX0A are the only instructions that look at the keyboard
+	U16 opcode = NextOpcode();
+	return (opcode & 0xF0FF) == 0xE09E || (opcode & 0xF0FF) == 0xE0A1 || (opcode & 0xF0FF) == 0xF00A;
+}
 
-		if (m_Log)
+U64 Chip8::Hash() const
+{
+	//FNV-1a over memory, registers, stack and screen, timers are left out on purpose
+	//so states that only differ in a countdown are seen as the same
+	U64 hash = 14695981039346656037ULL;
+	auto add = [&hash](U8 byte)
+	{
+		hash ^= byte;
+		hash *= 1099511628211ULL;
+	};
+	//memory past the highest write is always 0, only classic sized games are hashed as a whole
+	for (int i = 0; i < max(m_MemoryTop, 4096); i++)
+	{
+		add(m_Memory[i]);
+	}
+	for (U8 byte : m_Registers)
+	{
+		add(byte);
+	}
+	add(m_IndexRegister & 0xFF);
+	add(m_IndexRegister >> 8);
+	add(m_ProgramCounter & 0xFF);
+	add(m_ProgramCounter >> 8);
+	for (int i = 0; i < m_StackPointer; i++)
+	{
+		add(m_Stack[i] & 0xFF);
+		add(m_Stack[i] >> 8);
+	}
+	add(m_StackPointer);
+	for (U64 word : m_ScreenBuffer)
+	{
+		for (int i = 0; i < 64; i += 8)
 		{
-			Logger::getInstance()->LogOpcode(opcode);
+			add((U8)(word >> i));
 		}
-		//run the opcode
-		if (!RunCommand(opcode))
+	}
+	add(hiresmode);
+	add(m_ExtendedMode);
+	add(m_Planes);
+	return hash;
+}
+
+//murmur3's 64 bit finalizer, every bit of the input reaches every bit of the result
+static U64 Mix(U64 value)
+{
+	value ^= value >> 33;
+	value *= 0xFF51AFD7ED558CCDULL;
+	value ^= value >> 33;
+	value *= 0xC4CEB9FE1A85EC53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+//what one byte of memory or one word of the screen adds to the state hash. the terms are xored together so a write
+//takes out the old term and puts in the new one, a 0 adds nothing so untouched memory never needs hashing
+static U64 MemoryTerm(int address, U8 value)
+{
+	return value ? Mix((U64)address << 8 | value) : 0;
+}
+
+static U64 ScreenTerm(int index, U64 word)
+{
+	return word ? Mix(word ^ Mix(0x10000 + (U64)index)) : 0;
+}
+
+U64 Chip8::StateHash() const
+{
+#ifdef CHIP8_STATE_HASH
+	U64 hash = m_MemoryHash ^ (m_ScreenHash * 31);
+#else
+	U64 hash = HashMemory() ^ (HashScreen() * 31);
+#endif
+	//the registers are rewritten by nearly every instruction, they are cheaper to fold in here than to track.
+	//unlike Hash the timers and the generator count, two states that differ in them play out differently
+	auto add = [&hash](U64 value)
+	{
+		hash = Mix(hash ^ value);
+	};
+	U64 registers[2];
+	memcpy(registers, m_Registers.data(), sizeof(registers));
+	add(registers[0]);
+	add(registers[1]);
+	add(m_IndexRegister | (U64)m_ProgramCounter << 16 | (U64)m_StackPointer << 32 | (U64)m_Planes << 40 | (U64)hiresmode << 48 | (U64)m_ExtendedMode << 49);
+	add(m_DelayTimer | (U64)m_SoundTimer << 8 | (U64)m_Random << 32);
+	for (int i = 0; i < m_StackPointer; i++)
+	{
+		add(m_Stack[i]);
+	}
+	return hash;
+}
+
+U64 Chip8::HashMemory() const
+{
+	U64 hash = 0;
+	for (int i = 0; i < m_MemoryTop; i++)
+	{
+		hash ^= MemoryTerm(i, m_Memory[i]);
+	}
+	return hash;
+}
+
+U64 Chip8::HashScreen() const
+{
+	U64 hash = 0;
+	for (int i = 0; i < (int)m_ScreenBuffer.size(); i++)
+	{
+		hash ^= ScreenTerm(i, m_ScreenBuffer[i]);
+	}
+	return hash;
+}
+
+void Chip8::RehashMemory()
+{
+#ifdef CHIP8_STATE_HASH
+	m_MemoryHash = HashMemory();
+#endif
+}
+
+void Chip8::RehashScreen()
+{
+#ifdef CHIP8_STATE_HASH
+	m_ScreenHash = HashScreen();
+#endif
+}
+
+U8 Chip8::Pixel(int x, int y) const
+{
+	int word = y * ROW_WORDS + (x >> 6);
+	int bit = 63 - (x & 63);
+	return (U8)(((m_ScreenBuffer[word] >> bit) & 1) | (((m_ScreenBuffer[64 * ROW_WORDS + word] >> bit) & 1) << 1));
+}
+
+void Chip8::Unpack(U8* pixels) const
+{
+	int width = ScreenWidth();
+	int height = ScreenHeight();
+	for (int y = 0; y < height; y++)
+	{
+		for (int w = 0; w < width / 64; w++)
 		{
-			return false;
+			U64 first = m_ScreenBuffer[y * ROW_WORDS + w];
+			U64 second = m_ScreenBuffer[(64 + y) * ROW_WORDS + w];
+			for (int bit = 0; bit < 64; bit++)
+			{
+				*pixels++ = (U8)(((first >> (63 - bit)) & 1) | (((second >> (63 - bit)) & 1) << 1));
+			}
 		}
+	}
+}
 
-		//move to next position in m_Memory
-		m_ProgramCounter += 2;
+U8 Chip8::NextRandom()
+{
+	//the same steps as the c runtime rand, but the state belongs to this machine
+	m_Random = m_Random * 214013 + 2531011;
+	return (U8)(m_Random >> 16);
+}
+
+void Chip8::SkipNext()
+{
+	//F000 NNNN is four bytes long, skipping it means skipping the address as well
+	U16 next = m_Memory[(m_ProgramCounter + 2) & 0xFFFF] << 8 | m_Memory[(m_ProgramCounter + 3) & 0xFFFF];
+	m_ProgramCounter += (next == 0xF000) ? 4 : 2;
+}
 
-		//count down delay timer
-		if (m_DelayTimer > 0)
+void Chip8::WriteMemory(int address, U8 value)
+{
+	//addresses past the end of memory wrap around to 0
+	address &= 0xFFFF;
+#ifdef CHIP8_STATE_HASH
+	m_MemoryHash ^= MemoryTerm(address, m_Memory[address]) ^ MemoryTerm(address, value);
+#endif
+	m_Memory[address] = value;
+	m_DirtyMemory[address >> 14] |= 1ULL << ((address >> 8) & 63);
+	m_MemoryTop = max(m_MemoryTop, address + 1);
+}
+
+bool Chip8::DrawSprite(int x, int y, int rows, bool wide)
+{
+	int width = ScreenWidth();
+	int height = ScreenHeight();
+	int spritewidth = wide ? 16 : 8;
+	x %= width;
+	y %= height;
+
+	bool collision = false;
+	int address = m_IndexRegister;
+	for (int plane = 0; plane < PLANES; plane++)
+	{
+		if (!(m_Planes & (1 << plane)))
 		{
-			--m_DelayTimer;
+			continue;
 		}
-
-		//count down sound timer
-		if (m_SoundTimer > 0)
+		for (int row = 0; row < rows; row++)
 		{
-			if (m_SoundTimer == 1)
+			U64 bits = m_Memory[address & 0xFFFF];
+			if (wide)
+			{
+				bits = bits << 8 | m_Memory[(address + 1) & 0xFFFF];
+			}
+			address += wide ? 2 : 1;
+
+			//line the sprite up with the left edge, then rotate it into place so it wraps around the screen
+			U64 first = bits << (64 - spritewidth);
+			U64 second = 0;
+			if (width == 64)
+			{
+				first = x ? (first >> x) | (first << (64 - x)) : first;
+			}
+			else
 			{
-				BeepPlay();
+				int shift = x;
+				if (shift >= 64)
+				{
+					swap(first, second);
+					shift -= 64;
+				}
+				if (shift)
+				{
+					U64 carried = second << (64 - shift);
+					second = (second >> shift) | (first << (64 - shift));
+					first = (first >> shift) | carried;
+				}
 			}
-			--m_SoundTimer;
+
+			int screenrow = plane * 64 + (y + row) % height;
+			U64* line = &m_ScreenBuffer[screenrow * ROW_WORDS];
+			m_DirtyScreen |= 1 << (screenrow >> 4);
+			collision |= ((line[0] & first) | (line[1] & second)) != 0;
+#ifdef CHIP8_STATE_HASH
+			int index = screenrow * ROW_WORDS;
+			m_ScreenHash ^= ScreenTerm(index, line[0]) ^ ScreenTerm(index, line[0] ^ first);
+			m_ScreenHash ^= ScreenTerm(index + 1, line[1]) ^ ScreenTerm(index + 1, line[1] ^ second);
+#endif
+			line[0] ^= first;
+			line[1] ^= second;
 		}
+	}
+	return collision;
+}
+
+void Chip8::ClearScreen()
+{
+	//every plane, whatever m_Planes says
+	m_ScreenBuffer.fill(0);
+	m_DirtyScreen = 0xFF;
+	RehashScreen();
+}
 
-		//if program goes outside of the usable memory
-		if (m_ProgramCounter >= m_Size + PROGRAM_STARTPOS)
+void Chip8::ClearPlanes()
+{
+	for (int plane = 0; plane < PLANES; plane++)
+	{
+		if (m_Planes & (1 << plane))
 		{
-			return false;
+			m_DirtyScreen |= 0xF << (plane * 4);
+			fill(m_ScreenBuffer.begin() + plane * 64 * ROW_WORDS, m_ScreenBuffer.begin() + (plane + 1) * 64 * ROW_WORDS, 0);
 		}
 	}
-	return true;
+	RehashScreen();
 }
 
-void Chip8::Draw()
+void Chip8::ScrollVertical(int rows)
 {
-	if (m_GameLoaded)
+	//whole rows move, positive is down
+	int height = ScreenHeight();
+	int distance = min(abs(rows), height);
+	for (int plane = 0; plane < PLANES; plane++)
 	{
-		if (hiresmode)
+		if (!(m_Planes & (1 << plane)))
 		{
-			U8 pixelbuffer[64 * 64 * 3];
-			for (size_t i = 0; i < 64 * 64; i++)
-			{
-				U16 j = m_ScreenBuffer[i];
-				pixelbuffer[(i * 3) + 0] = j * 255;
-				pixelbuffer[(i * 3) + 1] = j * 255;
-				pixelbuffer[(i * 3) + 2] = j * 255;
-			}			//do hires drawing
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 64, 64, 0, GL_RGB, GL_UNSIGNED_BYTE, pixelbuffer);
+			continue;
+		}
+		U64* screen = &m_ScreenBuffer[plane * 64 * ROW_WORDS];
+		m_DirtyScreen |= 0xF << (plane * 4);
+		if (rows > 0)
+		{
+			memmove(screen + distance * ROW_WORDS, screen, (height - distance) * ROW_WORDS * sizeof(U64));
+			memset(screen, 0, distance * ROW_WORDS * sizeof(U64));
 		}
 		else
 		{
-			U8 pixelbuffer[64 * 32 * 3];
-			for (size_t i = 0; i < 64 * 32; i++)
+			memmove(screen, screen + distance * ROW_WORDS, (height - distance) * ROW_WORDS * sizeof(U64));
+			memset(screen + (height - distance) * ROW_WORDS, 0, distance * ROW_WORDS * sizeof(U64));
+		}
+	}
+	RehashScreen();
+}
+
+void Chip8::ScrollHorizontal(int pixels)
+{
+	//a row is shifted as a whole, positive is right, pixels shifted off the edge are lost
+	int height = ScreenHeight();
+	int shift = abs(pixels);
+	for (int plane = 0; plane < PLANES; plane++)
+	{
+		if (!(m_Planes & (1 << plane)))
+		{
+			continue;
+		}
+		m_DirtyScreen |= 0xF << (plane * 4);
+		for (int y = 0; y < height; y++)
+		{
+			U64* line = &m_ScreenBuffer[(plane * 64 + y) * ROW_WORDS];
+			if (!m_ExtendedMode)
+			{
+				line[0] = pixels > 0 ? line[0] >> shift : line[0] << shift;
+			}
+			else if (pixels > 0)
 			{
-				U16 j = m_ScreenBuffer[i];
-				pixelbuffer[(i * 3) + 0] = j * 255;
-				pixelbuffer[(i * 3) + 1] = j * 255;
-				pixelbuffer[(i * 3) + 2] = j * 255;
-			}			//do lowres drawing
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 64, 32, 0, GL_RGB, GL_UNSIGNED_BYTE, pixelbuffer);
+				line[1] = (line[1] >> shift) | (line[0] << (64 - shift));
+				line[0] >>= shift;
+			}
+			else
+			{
+				line[0] = (line[0] << shift) | (line[1] >> (64 - shift));
+				line[1] <<= shift;
+			}
 		}
 	}
+	RehashScreen();
+}
+
+int Chip8::PatternFrequency() const
+{
+	//Beep can only play square tones, so the pattern becomes the tone its rising edges repeat at
+	int edges = 0;
+	for (int i = 0; i < 128; i++)
+	{
+		int bit = (m_AudioPattern[i / 8] >> (7 - i % 8)) & 1;
+		int last = (m_AudioPattern[((i + 127) % 128) / 8] >> (7 - (i + 127) % 128 % 8)) & 1;
+		edges += bit && !last;
+	}
+	if (edges == 0)
+	{
+		return 0;
+	}
+	double rate = 4000.0 * pow(2.0, (m_Pitch - 64) / 48.0);
+	return max(37, min((int)(rate * edges / 128.0), 32767));
 }
 
-void Chip8::BeepPlay()
+void Chip8::BeepPlay(int frequency)
 {
-	//play a random sound
-	Beep(rand() % 800 + 500, 100);
+#ifndef CHIP8_HEADLESS
+	//play a random sound unless the game gave it a pattern
+	Beep(frequency > 0 ? frequency : rand() % 800 + 500, 100);
+#else
+	(void)frequency;
+#endif
 }
\ No newline at end of file
@@ -9,12 +9,59 @@ using namespace std;
 
 typedef unsigned char  U8;//8bytes
 typedef unsigned short U16;//16bytes
+typedef unsigned int   U32;//32bytes
+typedef unsigned long long U64;//64bytes
 
 struct GLFWwindow;
 
+//everything that changes while a game runs apart from memory and the screen
+struct Chip8Context
+{
+	array<U8, (size_t)16> m_Registers;
+	U16 m_IndexRegister;
+	U16 m_ProgramCounter;
+	array<U16, (size_t)16> m_Stack;
+	U8 m_StackPointer;
+	U8 m_DelayTimer;
+	U8 m_SoundTimer;
+	bool hiresmode;
+	bool m_ExtendedMode;
+	U8 m_Planes;
+	array<U8, (size_t)16> m_Flags;
+	array<U8, (size_t)16> m_AudioPattern;
+	U8 m_Pitch;
+	U32 m_Random;
+};
+
+//everything that changes while a game runs, copied out and back for run-ahead
+struct Chip8State
+{
+	vector<U8> m_Memory; //only up to the highest address ever written, the rest is known to be 0
+	array<U64, (size_t)(2 * 64 * 2)> m_ScreenBuffer;
+	Chip8Context m_Context;
+};
+
+//why RunFor handed control back
+enum ExitReason : U8
+{
+	EXIT_FRAME,				//ran every instruction it was given
+	EXIT_WAITING_FOR_KEY,	//on FX0A with no key held, the rest of the instructions only counted the timers down
+	EXIT_BREAKPOINT,		//the next instruction has a breakpoint, it did not run
+	EXIT_UNKNOWN_OPCODE,	//an opcode no variant has, or a call or return the stack has no room for
+	EXIT_OUT_OF_RANGE,		//the program counter went past the end of the rom
+	EXIT_STOPPED			//00FD
+};
+
+//the game can not go on after these
+inline bool Stops(ExitReason reason)
+{
+	return reason >= EXIT_UNKNOWN_OPCODE;
+}
+
 struct Chip8
 {
-	GLFWwindow* m_WindowPtr = nullptr; //the opengl window
+	static const int PLANES = 2;
+	static const int ROW_WORDS = 2; //128 pixels
 
 	Chip8(GLFWwindow* window)
 	{
@@ -22,33 +69,116 @@ struct Chip8
 		m_WindowPtr = window; 
 	}
 
-	//std array for safety reasons with memory
-	array<U8, (size_t)4096> m_Memory;
+	//hot: everything an instruction touches is packed at the front, the first 64 bytes hold what
+	//every step reads, the stack follows in the next cache line
 	array<U8, (size_t)16> m_Registers;
 	U16 m_IndexRegister;
 	U16 m_ProgramCounter;
-	int m_Size;
-
-	array<U8, (size_t)(64 * 64)> m_ScreenBuffer;
-	vector<U16> m_Stack;
-
+	U16 m_Keys = 0; //bit n is set while chip8 key n is held, sampled once per frame
+	U16 m_KeysRead = 0; //keys EX9E, EXA1 and FX0A looked at, cleared by whoever watches it
 	U8 m_DelayTimer;
 	U8 m_SoundTimer;
-	bool hiresmode;
+	U8 m_StackPointer; //amount of calls on the stack
+	U8 m_Planes; //xo-chip planes that drawing, clearing and scrolling work on, bit 0 is the first plane
+	bool hiresmode; //64x64 hack
+	bool m_ExtendedMode; //super-chip 128x64
 	bool m_GameLoaded;
 	bool m_Log;
+	bool m_Muted = false; //no sound, logging or hotkeys while running frames that will be rolled back
+	int m_Size;
+	int m_MemoryTop; //one past the highest address the rom or the game wrote to
+	U32 m_Random; //CXNN generator, per machine so two machines given the same seed draw the same numbers
+	array<U16, (size_t)16> m_Stack; //fixed size, 2NNN past 16 calls and 00EE without one stop the game
+	//256 byte chunks of memory and of the screen written since the last fork was restored, see ForkArena
+	array<U64, (size_t)4> m_DirtyMemory;
+	U8 m_DirtyScreen;
+#ifdef CHIP8_STATE_HASH
+	//memory and screen parts of StateHash, updated by every write so reading them costs nothing
+	U64 m_MemoryHash = 0;
+	U64 m_ScreenHash = 0;
+#endif
+
+	//2 planes of 64 rows of 128 pixels, one bit per pixel, x 0 is the top bit of the first word of a row.
+	//narrow modes only use the first word, so drawing and scrolling are shifts on whole rows
+	array<U64, (size_t)(PLANES * 64 * ROW_WORDS)> m_ScreenBuffer;
 
+	//std array for safety reasons with memory, xo-chip can address all 64kb
+	array<U8, (size_t)0x10000> m_Memory;
+
+	//cold: only touched by rare opcodes, sound and loading
+	array<U8, (size_t)16> m_Flags; //super-chip FX75/FX85 storage
+	array<U8, (size_t)16> m_AudioPattern; //xo-chip F002 sample, 128 one bit samples
+	U8 m_Pitch; //xo-chip FX3A, 64 plays the pattern at 4000 samples per second
+
+	GLFWwindow* m_WindowPtr = nullptr; //the opengl window
 	string m_Path;
+	vector<U8> m_Rom; //the loaded file, kept to restart the game without reading it again
 
 	static const int KeyBoardLayout[16];
 	static const unsigned char chip8_fontset[80];
+	static const unsigned char chip8_bigfontset[160];
 	static const U16 PROGRAM_STARTPOS = 0x200;
 	static const int AMOUNT_OF_KEYS = 16;
+	static const size_t STACK_SIZE = 16;
+	static const U16 BIGFONT_STARTPOS = 80;
+	static const size_t MAX_ROMSIZE = 0x10000 - PROGRAM_STARTPOS;
 
 	//functions
+	void Reset();
+	bool LoadRom(const U8* data, size_t size);
 	bool LoadGame(string path);
 	bool RunCommand(const U16 command);
+	//runs up to this many instructions in one loop, executed counts the ones that ran, the one that stopped the game included.
+	//breakpoints are patched into the predecoded engine, see Decoder::SetBreakpoint
+	ExitReason RunFor(int instructions, int& executed);
+	//one instruction, for tools that look at the machine after every one. false when the game stops
 	bool GameLoop();
-	void Draw();
-	static void BeepPlay();
+#ifndef CHIP8_HEADLESS
+	//the chip8 keys and the O (restart) and P (opcode log) hotkeys, once per frame
+	void PollKeys();
+#endif
+	void SaveState(Chip8State& state) const;
+	void LoadState(const Chip8State& state);
+	U16 NextOpcode() const;
+	bool ReadsKeys() const;
+	U64 Hash() const;
+	//tells states apart like Hash but with its own values, and the timers and the generator count. built with CHIP8_STATE_HASH the memory and the screen
+	//are hashed as they are written and this only folds in the registers, without it everything is hashed each call
+	U64 StateHash() const;
+
+	int ScreenWidth() const { return m_ExtendedMode ? 128 : 64; }
+	int ScreenHeight() const { return (m_ExtendedMode || hiresmode) ? 64 : 32; }
+	//the color of a pixel, bit 0 comes from the first plane and bit 1 from the second
+	U8 Pixel(int x, int y) const;
+	//the visible screen with one byte per pixel, ScreenWidth() * ScreenHeight() bytes
+	void Unpack(U8* pixels) const;
+
+	//0 plays a random tone
+	static void BeepPlay(int frequency = 0);
+
+private:
+	//the predecoded engine runs the same instructions through the helpers below
+	friend class Decoder;
+	friend class ForkArena;
+
+	void SaveContext(Chip8Context& context) const;
+	void LoadContext(const Chip8Context& context);
+	void MarkAllDirty();
+	U8 NextRandom();
+	void SkipNext();
+	template<bool Logging> ExitReason RunLoop(int instructions, int& executed);
+	//counts both timers down as often as they would have been by this many instructions
+	void StepTimers(int steps);
+	void WriteMemory(int address, U8 value);
+	bool DrawSprite(int x, int y, int rows, bool wide);
+	void ClearScreen();
+	void ClearPlanes();
+	void ScrollVertical(int rows);
+	void ScrollHorizontal(int pixels);
+	int PatternFrequency() const;
+	U64 HashMemory() const;
+	U64 HashScreen() const;
+	//after memory or the screen changed in one go, nothing without CHIP8_STATE_HASH
+	void RehashMemory();
+	void RehashScreen();
 };
\ No newline at end of file
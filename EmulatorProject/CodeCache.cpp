@@ -0,0 +1,145 @@
+#include "CodeCache.h"
+#include <windows.h>
+#include <experimental/filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <cstring>
+
+namespace fs = std::experimental::filesystem;
+
+static const char CACHE_MAGIC[4] = { 'C', '8', 'C', 'C' };
+
+bool CodeCache::Open(const vector<U8>& rom)
+{
+	Close();
+	std::stringstream name;
+	name << m_Folder << "/" << std::hex << std::setfill('0') << std::setw(16) << RomIndex::HashBytes(rom) << ".c8code";
+	string path = name.str();
+
+	m_Cached = Map(path, rom);
+	return m_Cached || Build(path, rom);
+}
+
+void CodeCache::Close()
+{
+	if (m_Data != nullptr)
+	{
+		UnmapViewOfFile(m_Data);
+	}
+	if (m_Mapping != nullptr)
+	{
+		CloseHandle(m_Mapping);
+	}
+	if (m_File != nullptr)
+	{
+		CloseHandle(m_File);
+	}
+	m_Data = nullptr;
+	m_Mapping = nullptr;
+	m_File = nullptr;
+	m_Built.clear();
+	m_Instructions = nullptr;
+	m_InstructionCount = 0;
+	m_Cached = false;
+}
+
+bool CodeCache::Map(const string& path, const vector<U8>& rom)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	m_File = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || (size_t)size.QuadPart != sizeof(Header) + rom.size() * sizeof(DecodedOpcode))
+	{
+		Close();
+		return false;
+	}
+	m_Mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_Mapping == NULL)
+	{
+		Close();
+		return false;
+	}
+	m_Data = (const U8*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_Data == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	//a file of another rom with the same hash, an older layout or an older decoder is no use
+	const Header* header = (const Header*)m_Data;
+	if (memcmp(header->m_Magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header->m_Format != FORMAT ||
+		header->m_Engine != Decoder::VERSION || header->m_RomSize != rom.size() || header->m_InstructionCount != rom.size() ||
+		header->m_RomHash != RomIndex::HashBytes(rom))
+	{
+		Close();
+		return false;
+	}
+
+	m_Analysis.m_Size = header->m_RomSize;
+	m_Analysis.m_Hash = header->m_RomHash;
+	m_Analysis.m_Variant = header->m_Variant;
+	m_Analysis.m_Quirks = header->m_Quirks;
+	m_Analysis.m_Thumbnail = header->m_Thumbnail;
+	m_Instructions = (const DecodedOpcode*)(m_Data + sizeof(Header));
+	m_InstructionCount = header->m_InstructionCount;
+	return true;
+}
+
+bool CodeCache::Build(const string& path, const vector<U8>& rom)
+{
+	static_assert(sizeof(DecodedOpcode) == 8 && sizeof(Header) % sizeof(DecodedOpcode) == 0, "the opcodes follow the header unpadded");
+
+	RomIndex::Analyse(rom, m_Analysis);
+	Header header = {};
+	memcpy(header.m_Magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.m_Format = FORMAT;
+	header.m_Engine = Decoder::VERSION;
+	header.m_RomHash = m_Analysis.m_Hash;
+	header.m_RomSize = (U32)rom.size();
+	header.m_InstructionCount = (U32)rom.size();
+	header.m_Variant = m_Analysis.m_Variant;
+	header.m_Quirks = m_Analysis.m_Quirks;
+	header.m_Thumbnail = m_Analysis.m_Thumbnail;
+
+	//every byte can start an instruction, jumps do not have to be even, and the byte after the rom is 0 in memory
+	m_Built.resize(sizeof(Header) + rom.size() * sizeof(DecodedOpcode));
+	memcpy(m_Built.data(), &header, sizeof(Header));
+	DecodedOpcode* instructions = (DecodedOpcode*)(m_Built.data() + sizeof(Header));
+	for (size_t i = 0; i < rom.size(); i++)
+	{
+		instructions[i] = Decoder::Split((U16)(rom[i] << 8 | (i + 1 < rom.size() ? rom[i + 1] : 0)));
+	}
+	m_Instructions = instructions;
+	m_InstructionCount = (U32)rom.size();
+
+	//written next to its place and moved there, so another run never maps half a file
+	error_code error;
+	fs::create_directories(m_Folder, error);
+	std::stringstream temporary;
+	temporary << path << "." << hash<thread::id>()(this_thread::get_id()) << ".tmp";
+	{
+		ofstream out(temporary.str(), ofstream::out | ofstream::binary | ofstream::trunc);
+		out.write((const char*)m_Built.data(), m_Built.size());
+		if (!out.good())
+		{
+			out.close();
+			fs::remove(temporary.str(), error);
+			return false;
+		}
+	}
+	fs::rename(temporary.str(), path, error);
+	if (error)
+	{
+		fs::remove(temporary.str(), error);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Chip8.h"
+#include "Decoder.h"
+#include "RomIndex.h"
+
+using namespace std;
+
+//what every start of a rom would work out again, kept in a file per rom hash: the analysis the rom index makes
+//and the decoded opcode of every address of the rom. the file is mapped instead of read, and only used when
+//it was made from the same rom by the same version of the decoder, anything else is made again and rewritten
+class CodeCache
+{
+public:
+	CodeCache(const string& folder) : m_Folder(folder) {}
+	~CodeCache() { Close(); }
+
+	//maps or makes the cache of this rom, false when it had to be made and could not be written,
+	//the cache can still be used then, it is just not kept
+	bool Open(const vector<U8>& rom);
+	void Close();
+
+	//true when the last Open found a valid file
+	bool WasCached() const { return m_Cached; }
+	const RomEntry& GetAnalysis() const { return m_Analysis; }
+	//the decoded opcode at PROGRAM_STARTPOS + i, for every byte of the rom
+	const DecodedOpcode* GetInstructions() const { return m_Instructions; }
+	U32 GetInstructionCount() const { return m_InstructionCount; }
+
+private:
+	static const U16 FORMAT = 1;
+
+	//the file is this header followed by the decoded opcodes
+	struct Header
+	{
+		char m_Magic[4];
+		U16 m_Format;
+		U16 m_Engine; //Decoder::VERSION
+		U64 m_RomHash;
+		U32 m_RomSize;
+		U32 m_InstructionCount;
+		U8 m_Variant;
+		U8 m_Quirks;
+		U8 m_Unused[6];
+		array<U8, 64 * 64 / 8> m_Thumbnail;
+	};
+
+	bool Map(const string& path, const vector<U8>& rom);
+	bool Build(const string& path, const vector<U8>& rom);
+
+	string m_Folder;
+	bool m_Cached = false;
+	RomEntry m_Analysis;
+	const DecodedOpcode* m_Instructions = nullptr;
+	U32 m_InstructionCount = 0;
+
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+	const U8* m_Data = nullptr;
+	vector<U8> m_Built; //the cache when it could not be mapped
+};
@@ -0,0 +1,100 @@
+//round trip check of the session frame encoding, not part of the normal build.
+//Build it headless, with the sanitizers so a malformed frame that writes past the screen shows up, for example with clang:
+//	clang++ -std=c++14 -O1 -g -fsanitize=address,undefined -DCHIP8_HEADLESS CodecCheck.cpp SessionServer.cpp Scheduler.cpp Chip8.cpp Opcodes.cpp Logger.cpp -lws2_32 -o codec_check
+//and run it with ./codec_check, it prints every check that failed and returns 1 when there was one
+#include "SessionServer.h"
+#include <cstdio>
+
+static int failures = 0;
+
+static void Expect(bool passed, const char* what)
+{
+	if (!passed)
+	{
+		printf("failed: %s\n", what);
+		++failures;
+	}
+}
+
+//encodes current against previous and decodes it onto a copy of previous, true when that gives current back
+static bool RoundTrips(const vector<U8>& previous, const vector<U8>& current, vector<U8>& encoded)
+{
+	encoded.clear();
+	SessionServer::Encode(previous.data(), current.data(), previous.size(), encoded);
+	vector<U8> screen = previous;
+	return SessionServer::Decode(encoded.data(), encoded.size(), screen.data(), screen.size()) && screen == current;
+}
+
+//a pair header followed by literals bytes of 0xFF
+static vector<U8> Pair(size_t zeros, size_t literals, size_t written)
+{
+	vector<U8> data = { (U8)zeros, (U8)(zeros >> 8), (U8)literals, (U8)(literals >> 8) };
+	data.resize(4 + written, 0xFF);
+	return data;
+}
+
+static bool Decodes(const vector<U8>& data, size_t size)
+{
+	vector<U8> screen(size, 0);
+	return SessionServer::Decode(data.data(), data.size(), screen.data(), screen.size());
+}
+
+int main()
+{
+	const size_t size = SessionServer::FRAME_BYTES;
+	vector<U8> previous(size);
+	for (size_t i = 0; i < size; i++)
+	{
+		previous[i] = (U8)(i * 37);
+	}
+	vector<U8> encoded;
+
+	Expect(RoundTrips(previous, previous, encoded), "static screen");
+	Expect(encoded.size() == 4, "a static screen is one 4 byte pair");
+
+	//gaps shorter and longer than a pair header, and the last byte
+	vector<U8> sparse = previous;
+	for (size_t i : { (size_t)0, (size_t)2, (size_t)3, (size_t)100, size - 1 })
+	{
+		sparse[i] ^= 0x81;
+	}
+	Expect(RoundTrips(previous, sparse, encoded), "sparse change");
+
+	vector<U8> full(size);
+	for (size_t i = 0; i < size; i++)
+	{
+		full[i] = ~previous[i];
+	}
+	Expect(RoundTrips(previous, full, encoded), "every byte changed");
+
+	//runs past the 16 bit counts are split over several pairs
+	const size_t large = 0x30000;
+	vector<U8> before(large);
+	for (size_t i = 0; i < large; i++)
+	{
+		before[i] = (U8)(i * 37);
+	}
+	Expect(RoundTrips(before, before, encoded), "static screen longer than 0xFFFF bytes");
+	vector<U8> after = before;
+	for (size_t i = 0x18000; i < 0x2C000; i++)
+	{
+		after[i] ^= 0x5A;
+	}
+	Expect(RoundTrips(before, after, encoded), "zero and literal runs longer than 0xFFFF bytes");
+
+	//malformed frames are turned down without writing past the screen
+	Expect(!Decodes(vector<U8>(), size), "empty frame");
+	Expect(!Decodes(vector<U8>{ 0, 8, 0 }, size), "pair header cut short");
+	vector<U8> trailing = Pair(size, 0, 0);
+	trailing.push_back(0);
+	trailing.push_back(0);
+	Expect(!Decodes(trailing, size), "half a pair header after a whole frame");
+	Expect(!Decodes(Pair(size + 1, 0, 0), size), "zeros past the screen");
+	Expect(!Decodes(Pair(size - 1, 2, 2), size), "literals past the screen");
+	Expect(!Decodes(Pair(size - 10, 10, 5), size), "literals past the end of the frame");
+	Expect(!Decodes(Pair(size - 10, 0, 0), size), "frame short of the screen");
+	Expect(Decodes(Pair(size - 10, 10, 10), size), "well formed pair");
+
+	printf("%d checks failed\n", failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,407 @@
+#include "UnixSocket.h"
+#include "Debugger.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+
+Debugger::Debugger() : m_Breakpoints(0x10000, false), m_MemoryWatches(0x10000, false)
+{
+	UpdateDispatch();
+}
+
+Debugger::~Debugger()
+{
+	if (m_Client != ~0ULL)
+	{
+		closesocket((SOCKET)m_Client);
+	}
+	if (m_Listener != ~0ULL)
+	{
+		closesocket((SOCKET)m_Listener);
+	}
+}
+
+bool Debugger::Listen(const string& path)
+{
+	if (!StartWinsock() || path.size() >= sizeof(UnixAddress::sun_path))
+	{
+		return false;
+	}
+	SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (s == INVALID_SOCKET)
+	{
+		return false;
+	}
+
+	//a socket file left behind by an earlier run would make bind fail
+	DeleteFileA(path.c_str());
+	UnixAddress address = {};
+	address.sun_family = AF_UNIX;
+	strncpy_s(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+	unsigned long nonblocking = 1;
+	if (bind(s, (sockaddr*)&address, sizeof(address)) != 0 || listen(s, 1) != 0 || ioctlsocket(s, FIONBIO, &nonblocking) != 0)
+	{
+		closesocket(s);
+		return false;
+	}
+	m_Listener = s;
+	return true;
+}
+
+void Debugger::Poll(Chip8& machine)
+{
+	if (m_Listener == ~0ULL)
+	{
+		return;
+	}
+	if (m_Client == ~0ULL)
+	{
+		SOCKET client = accept((SOCKET)m_Listener, NULL, NULL);
+		if (client == INVALID_SOCKET)
+		{
+			return;
+		}
+		unsigned long nonblocking = 1;
+		ioctlsocket(client, FIONBIO, &nonblocking);
+		m_Client = client;
+		m_Received.clear();
+		Send("chip8 debugger");
+	}
+
+	//read whatever arrived, a command is only run once its whole line is there
+	char buffer[512];
+	int received;
+	while ((received = recv((SOCKET)m_Client, buffer, sizeof(buffer), 0)) > 0)
+	{
+		m_Received.append(buffer, received);
+	}
+	if (received == 0 || (received == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK))
+	{
+		//the tool went away, breakpoints stay but the game should not hang on them
+		closesocket((SOCKET)m_Client);
+		m_Client = ~0ULL;
+		Continue();
+		return;
+	}
+
+	size_t end;
+	while ((end = m_Received.find('\n')) != string::npos)
+	{
+		string line = m_Received.substr(0, end);
+		m_Received.erase(0, end + 1);
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+		if (!line.empty())
+		{
+			Send(Execute(machine, line));
+		}
+	}
+}
+
+void Debugger::Send(const string& line)
+{
+	if (m_Client == ~0ULL)
+	{
+		return;
+	}
+	string data = line + "\n";
+	send((SOCKET)m_Client, data.c_str(), (int)data.size(), 0);
+}
+
+void Debugger::UpdateDispatch()
+{
+	//nothing to check but breakpoints means the plain loop, so an idle debugger costs nothing per instruction
+	bool checks = m_MemoryWatchCount > 0 || m_RegisterWatches != 0 || m_Paused || m_Stepping || m_SteppingOver;
+	m_Run = checks ? &Debugger::RunLoop<true> : &Debugger::RunLoop<false>;
+}
+
+void Debugger::SetBreakpoint(U16 address, bool set)
+{
+	if (m_Breakpoints[address] != set)
+	{
+		m_Breakpoints[address] = set;
+		m_BreakpointCount += set ? 1 : -1;
+		m_Decoder.SetBreakpoint(address, set);
+	}
+	UpdateDispatch();
+}
+
+void Debugger::SetMemoryWatch(U16 address, bool set)
+{
+	if (m_MemoryWatches[address] != set)
+	{
+		m_MemoryWatches[address] = set;
+		m_MemoryWatchCount += set ? 1 : -1;
+	}
+	UpdateDispatch();
+}
+
+void Debugger::SetRegisterWatch(int index, bool set)
+{
+	if (set)
+	{
+		m_RegisterWatches |= 1 << (index & 0xF);
+	}
+	else
+	{
+		m_RegisterWatches &= ~(1 << (index & 0xF));
+	}
+	UpdateDispatch();
+}
+
+void Debugger::Pause()
+{
+	m_Paused = true;
+	m_Stepping = false;
+	m_SteppingOver = false;
+	UpdateDispatch();
+}
+
+void Debugger::Continue()
+{
+	m_Resumed = m_Paused;
+	m_Paused = false;
+	m_Stepping = false;
+	m_SteppingOver = false;
+	UpdateDispatch();
+}
+
+void Debugger::Step()
+{
+	m_Resumed = m_Paused;
+	m_Paused = false;
+	m_Stepping = true;
+	UpdateDispatch();
+}
+
+void Debugger::StepOver(const Chip8& machine)
+{
+	if ((machine.NextOpcode() & 0xF000) != 0x2000)
+	{
+		Step();
+		return;
+	}
+	//run until the call returns to the instruction after it, recursion has to unwind to the same depth
+	m_ReturnAddress = machine.m_ProgramCounter + 2;
+	m_ReturnDepth = machine.m_StackPointer;
+	m_Resumed = m_Paused;
+	m_Paused = false;
+	m_SteppingOver = true;
+	UpdateDispatch();
+}
+
+void Debugger::Stop(const Chip8& machine, const string& reason)
+{
+	m_Paused = true;
+	m_Stepping = false;
+	m_SteppingOver = false;
+	UpdateDispatch();
+
+	std::stringstream stream;
+	stream << "stopped " << reason << " pc " << std::hex << std::setfill('0') << std::setw(4) << machine.m_ProgramCounter;
+	Send(stream.str());
+}
+
+bool Debugger::WriteRange(const Chip8& machine, U16 opcode, int& first, int& count)
+{
+	//FX33, FX55 and 5XY2 are the only instructions that write memory
+	int x = (opcode >> 8) & 0xF;
+	int y = (opcode >> 4) & 0xF;
+	first = machine.m_IndexRegister;
+	if ((opcode & 0xF0FF) == 0xF033)
+	{
+		count = 3;
+	}
+	else if ((opcode & 0xF0FF) == 0xF055)
+	{
+		count = x + 1;
+	}
+	else if ((opcode & 0xF00F) == 0x5002)
+	{
+		count = abs(y - x) + 1;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+template<bool Debug>
+int Debugger::RunLoop(Chip8& machine, int instructions, bool& running)
+{
+	int executed = 0;
+	if (!Debug)
+	{
+		//breakpoints alone are traps in the predecoded table, the one we stopped at runs first to get past it
+		if (m_Resumed && running && instructions > 0)
+		{
+			running = machine.GameLoop();
+			m_Resumed = false;
+			++executed;
+		}
+		if (!running)
+		{
+			return executed;
+		}
+		int ran = 0;
+		ExitReason reason = m_BreakpointCount > 0 ? m_Decoder.RunFor(machine, instructions - executed, ran) : machine.RunFor(instructions - executed, ran);
+		running = !Stops(reason);
+		if (reason == EXIT_BREAKPOINT)
+		{
+			Stop(machine, "breakpoint");
+		}
+		return executed + ran;
+	}
+
+	for (; executed < instructions && running && !m_Paused; executed++)
+	{
+		if (m_Breakpoints[machine.m_ProgramCounter] && !m_Resumed)
+		{
+			Stop(machine, "breakpoint");
+			break;
+		}
+		m_Resumed = false;
+
+		U16 opcode = machine.NextOpcode();
+		int first = 0;
+		int count = 0;
+		bool writes = m_MemoryWatchCount > 0 && WriteRange(machine, opcode, first, count);
+		array<U8, (size_t)16> registers = machine.m_Registers;
+
+		running = machine.GameLoop();
+
+		//watchpoints stop after the instruction so the tool sees the new value
+		for (int i = 0; writes && i < count; i++)
+		{
+			if (m_MemoryWatches[(first + i) & 0xFFFF])
+			{
+				std::stringstream stream;
+				stream << "watch " << std::hex << std::setfill('0') << std::setw(4) << ((first + i) & 0xFFFF);
+				Stop(machine, stream.str());
+				writes = false;
+			}
+		}
+		for (int i = 0; m_RegisterWatches && i < 16 && !m_Paused; i++)
+		{
+			if (((m_RegisterWatches >> i) & 1) && registers[i] != machine.m_Registers[i])
+			{
+				std::stringstream stream;
+				stream << "watch v" << std::hex << std::uppercase << i;
+				Stop(machine, stream.str());
+			}
+		}
+		if (m_Paused)
+		{
+			++executed;
+			break;
+		}
+
+		if (m_Stepping || (m_SteppingOver && machine.m_ProgramCounter == m_ReturnAddress && machine.m_StackPointer == m_ReturnDepth))
+		{
+			Stop(machine, "step");
+			++executed;
+			break;
+		}
+	}
+	return executed;
+}
+
+static bool ParseNumber(istream& stream, int& value)
+{
+	//addresses and values are hex, with or without 0x
+	string text;
+	if (!(stream >> text))
+	{
+		return false;
+	}
+	char* end = nullptr;
+	long parsed = strtol(text.c_str(), &end, 16);
+	if (*end != '\0' || parsed < 0 || parsed > 0xFFFF)
+	{
+		return false;
+	}
+	value = (int)parsed;
+	return true;
+}
+
+string Debugger::Execute(Chip8& machine, const string& command)
+{
+	std::stringstream in(command);
+	string name;
+	in >> name;
+	int value = 0;
+
+	std::stringstream out;
+	out << std::hex << std::setfill('0');
+	if ((name == "break" || name == "delete") && ParseNumber(in, value))
+	{
+		SetBreakpoint((U16)value, name == "break");
+	}
+	else if ((name == "watch" || name == "unwatch") && ParseNumber(in, value))
+	{
+		SetMemoryWatch((U16)value, name == "watch");
+	}
+	else if ((name == "watchreg" || name == "unwatchreg") && ParseNumber(in, value) && value < 16)
+	{
+		SetRegisterWatch(value, name == "watchreg");
+	}
+	else if (name == "pause")
+	{
+		Pause();
+		Stop(machine, "pause");
+	}
+	else if (name == "continue")
+	{
+		Continue();
+	}
+	else if (name == "step")
+	{
+		Step();
+	}
+	else if (name == "next")
+	{
+		StepOver(machine);
+	}
+	else if (name == "regs")
+	{
+		out << "pc " << std::setw(4) << machine.m_ProgramCounter << " i " << std::setw(4) << machine.m_IndexRegister
+			<< " sp " << (int)machine.m_StackPointer << " dt " << std::setw(2) << (int)machine.m_DelayTimer
+			<< " st " << std::setw(2) << (int)machine.m_SoundTimer << " v";
+		for (U8 reg : machine.m_Registers)
+		{
+			out << " " << std::setw(2) << (int)reg;
+		}
+		return out.str();
+	}
+	else if (name == "stack")
+	{
+		out << "stack";
+		for (int i = 0; i < machine.m_StackPointer; i++)
+		{
+			out << " " << std::setw(4) << machine.m_Stack[i];
+		}
+		return out.str();
+	}
+	else if (name == "mem" && ParseNumber(in, value))
+	{
+		//at most 256 bytes per line, wrapping at the end of memory like the machine does
+		int length = 16;
+		ParseNumber(in, length);
+		length = min(length, 256);
+		out << "mem " << std::setw(4) << value;
+		for (int i = 0; i < length; i++)
+		{
+			out << " " << std::setw(2) << (int)machine.m_Memory[(value + i) & 0xFFFF];
+		}
+		return out.str();
+	}
+	else
+	{
+		return "error " + command;
+	}
+	return "ok";
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Chip8.h"
+#include "Decoder.h"
+
+using namespace std;
+
+//breakpoints, watchpoints and stepping for the running machine, driven by a tool attached over a unix socket.
+//the frame loop runs its instructions through Run, which only checks anything while there is something to check,
+//with no breakpoints, watchpoints or stepping it is the same loop as without a debugger.
+//breakpoints alone run on the predecoded engine with a trap patched in at each address, that loop does not look for them
+class Debugger
+{
+public:
+	Debugger();
+	~Debugger();
+
+	//waits for a tool on the unix socket at this path, one at a time
+	bool Listen(const string& path);
+	//accepts a tool and handles the commands it sent, once per frame
+	void Poll(Chip8& machine);
+
+	//runs up to this many instructions, fewer when something makes it stop, running turns false when the game stops
+	int Run(Chip8& machine, int instructions, bool& running) { return (this->*m_Run)(machine, instructions, running); }
+
+	void SetBreakpoint(U16 address, bool set);
+	void SetMemoryWatch(U16 address, bool set);
+	void SetRegisterWatch(int index, bool set);
+	void Pause();
+	void Continue();
+	void Step();
+	//runs a 2NNN call up to its return as one step
+	void StepOver(const Chip8& machine);
+	bool IsPaused() const { return m_Paused; }
+
+	//one line of the protocol, the reply has no trailing newline
+	string Execute(Chip8& machine, const string& command);
+
+private:
+	typedef int (Debugger::*RunFunction)(Chip8& machine, int instructions, bool& running);
+
+	//the loop with or without the checks, swapped whenever breakpoints, watches or stepping change
+	template<bool Debug> int RunLoop(Chip8& machine, int instructions, bool& running);
+	void UpdateDispatch();
+	void Stop(const Chip8& machine, const string& reason);
+	void Send(const string& line);
+	//the address range an opcode writes, false when it does not write memory
+	static bool WriteRange(const Chip8& machine, U16 opcode, int& first, int& count);
+
+	RunFunction m_Run;
+
+	vector<bool> m_Breakpoints;
+	int m_BreakpointCount = 0;
+	Decoder m_Decoder; //holds the traps
+	vector<bool> m_MemoryWatches;
+	int m_MemoryWatchCount = 0;
+	U16 m_RegisterWatches = 0; //bit n watches VN
+
+	bool m_Paused = false;
+	bool m_Stepping = false;
+	bool m_Resumed = false; //the next instruction runs even when it has a breakpoint, it is the one we stopped at
+	bool m_SteppingOver = false;
+	U16 m_ReturnAddress = 0;
+	U8 m_ReturnDepth = 0;
+
+	unsigned long long m_Listener = ~0ULL; //SOCKET, kept opaque so winsock stays out of the header
+	unsigned long long m_Client = ~0ULL;
+	string m_Received;
+};
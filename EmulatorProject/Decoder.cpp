@@ -0,0 +1,339 @@
+#include "Decoder.h"
+#include "CodeCache.h"
+#include <algorithm>
+#include <cstdlib>
+
+using namespace Opcodes;
+
+DecodedOpcode Decoder::Split(U16 opcode)
+{
+	DecodedOpcode decoded = {};
+	Operation operation = Lookup(opcode);
+	decoded.m_Opcode = opcode;
+	decoded.m_Operation = operation;
+	decoded.m_X = (opcode >> 8) & 0xF;
+	decoded.m_Y = (opcode >> 4) & 0xF;
+	switch (operation)
+	{
+	case JP: case CALL: case LD_I: case JP_V0:
+		decoded.m_Value = opcode & 0xFFF;
+		break;
+	case SCD: case SCU: case DRW:
+		decoded.m_Value = opcode & 0xF;
+		break;
+	default:
+		decoded.m_Value = opcode & 0xFF;
+		break;
+	}
+	return decoded;
+}
+
+Decoder::Instruction Decoder::Bind(const DecodedOpcode& decoded)
+{
+	static const Handler* handlers = MakeHandlers(make_index_sequence<OPERATION_COUNT>());
+
+	Instruction instruction;
+	instruction.m_Handler = handlers[decoded.m_Operation < OPERATION_COUNT ? (int)decoded.m_Operation : (int)UNKNOWN];
+	instruction.m_Opcode = decoded.m_Opcode;
+	//preloaded instructions come from a mapped file, a bad register index must not reach past the registers
+	instruction.m_X = decoded.m_X & 0xF;
+	instruction.m_Y = decoded.m_Y & 0xF;
+	instruction.m_Value = decoded.m_Value;
+	return instruction;
+}
+
+void Decoder::Preload(const CodeCache& cache)
+{
+	const DecodedOpcode* decoded = cache.GetInstructions();
+	for (U32 i = 0; i < cache.GetInstructionCount(); i++)
+	{
+		Instruction& entry = m_Table[Chip8::PROGRAM_STARTPOS + i];
+		entry = Bind(decoded[i]);
+		//breakpoints set before the cache was taken stay in place
+		if (m_Traps[Chip8::PROGRAM_STARTPOS + i])
+		{
+			entry.m_Handler = &Trap;
+		}
+	}
+}
+
+template<size_t... Ops>
+const Decoder::Handler* Decoder::MakeHandlers(index_sequence<Ops...>)
+{
+	static const Handler handlers[] = { &Execute<(int)Ops>... };
+	return handlers;
+}
+
+template<int Op>
+bool Decoder::Execute(Chip8& machine, const Instruction& instruction)
+{
+	//Op is known when the handler is made, every handler is only its own case
+	U8* v = machine.m_Registers.data();
+	int x = instruction.m_X;
+	int y = instruction.m_Y;
+	U16 value = instruction.m_Value;
+	switch (Op)
+	{
+	case CLS: machine.ClearPlanes(); break;
+	case RET:
+		if (machine.m_StackPointer == 0)
+		{
+			return false;
+		}
+		machine.m_ProgramCounter = machine.m_Stack[--machine.m_StackPointer];
+		break;
+	case SCD: machine.ScrollVertical(value); break;
+	case SCU: machine.ScrollVertical(-value); break;
+	case SCR: machine.ScrollHorizontal(4); break;
+	case SCL: machine.ScrollHorizontal(-4); break;
+	case EXIT: return false;
+	case LOW:
+	case HIGH:
+		machine.m_ExtendedMode = Op == HIGH;
+		machine.ClearScreen();
+		break;
+	case JP:
+		//the 64x64 hack, the same as the JP case of RunCommand
+		if (machine.m_ProgramCounter == Chip8::PROGRAM_STARTPOS && value == 0x260)
+		{
+			machine.hiresmode = true;
+			value = 0x2C0;
+		}
+		machine.m_ProgramCounter = value - 2;
+		break;
+	case CALL:
+		if (machine.m_StackPointer >= Chip8::STACK_SIZE)
+		{
+			return false;
+		}
+		machine.m_Stack[machine.m_StackPointer++] = machine.m_ProgramCounter;
+		machine.m_ProgramCounter = value - 2;
+		break;
+	case SE_VB: if (v[x] == value) machine.SkipNext(); break;
+	case SNE_VB: if (v[x] != value) machine.SkipNext(); break;
+	case SE_VV: if (v[x] == v[y]) machine.SkipNext(); break;
+	case SAVE_RANGE:
+	case LOAD_RANGE:
+	{
+		int step = x <= y ? 1 : -1;
+		for (int i = 0; i <= abs(y - x); i++)
+		{
+			if (Op == SAVE_RANGE)
+			{
+				machine.WriteMemory(machine.m_IndexRegister + i, v[x + i * step]);
+			}
+			else
+			{
+				v[x + i * step] = machine.m_Memory[(machine.m_IndexRegister + i) & 0xFFFF];
+			}
+		}
+	}break;
+	case LD_VB: v[x] = (U8)value; break;
+	case ADD_VB: v[x] += (U8)value; break;
+	case LD_VV: v[x] = v[y]; break;
+	case OR: v[x] |= v[y]; break;
+	case AND: v[x] &= v[y]; break;
+	case XOR: v[x] ^= v[y]; break;
+	case ADD_VV:
+	{
+		int result = v[x] + v[y];
+		v[x] = (U8)result;
+		v[0xF] = result > 255 ? 1 : 0;
+	}break;
+	case SUB:
+	case SUBN:
+		//both subtract VY from VX, only the borrow differs, the same as RunCommand
+		v[0xF] = (Op == SUB ? v[x] < v[y] : v[y] < v[x]) ? 0 : 1;
+		v[x] -= v[y];
+		break;
+	case SHR:
+		v[0xF] = v[x] & 0xF;
+		v[x] >>= 1;
+		break;
+	case SHL:
+		v[0xF] = (v[x] >> 7) & 0xF;
+		v[x] <<= 1;
+		break;
+	case SNE_VV: if (v[x] != v[y]) machine.SkipNext(); break;
+	case LD_I: machine.m_IndexRegister = value; break;
+	case JP_V0: machine.m_ProgramCounter = value + v[0] - 2; break;
+	case RND: v[x] = machine.NextRandom() & value; break;
+	case DRW:
+	{
+		bool collision = machine.DrawSprite(v[x], v[y], value == 0 ? 16 : value, value == 0);
+		v[0xF] = collision ? 1 : 0;
+	}break;
+	case SKP:
+		machine.m_KeysRead |= 1 << (v[x] & 0xF);
+		if ((machine.m_Keys >> (v[x] & 0xF)) & 1) machine.SkipNext();
+		break;
+	case SKNP:
+		machine.m_KeysRead |= 1 << (v[x] & 0xF);
+		if (!((machine.m_Keys >> (v[x] & 0xF)) & 1)) machine.SkipNext();
+		break;
+	case LD_I_LONG:
+		machine.m_IndexRegister = machine.m_Memory[(machine.m_ProgramCounter + 2) & 0xFFFF] << 8 | machine.m_Memory[(machine.m_ProgramCounter + 3) & 0xFFFF];
+		machine.m_ProgramCounter += 2;
+		break;
+	case PLANE: machine.m_Planes = x & 0x3; break;
+	case AUDIO:
+		for (size_t i = 0; i < machine.m_AudioPattern.size(); i++)
+		{
+			machine.m_AudioPattern[i] = machine.m_Memory[(machine.m_IndexRegister + i) & 0xFFFF];
+		}
+		break;
+	case LD_VDT: v[x] = machine.m_DelayTimer; break;
+	case LD_KEY:
+		//stays on this instruction until a key is held
+		machine.m_KeysRead |= machine.m_Keys;
+		machine.m_ProgramCounter -= 2;
+		for (int i = 0; i < Chip8::AMOUNT_OF_KEYS; i++)
+		{
+			if ((machine.m_Keys >> i) & 1)
+			{
+				v[x] = (U8)i;
+				machine.m_ProgramCounter += 2;
+				break;
+			}
+		}
+		break;
+	case LD_DT: machine.m_DelayTimer = v[x]; break;
+	case LD_ST: machine.m_SoundTimer = v[x]; break;
+	case ADD_I: machine.m_IndexRegister += v[x]; break;
+	case LD_F: machine.m_IndexRegister = v[x] * 5; break;
+	case LD_HF: machine.m_IndexRegister = Chip8::BIGFONT_STARTPOS + (v[x] & 0xF) * 10; break;
+	case PITCH: machine.m_Pitch = v[x]; break;
+	case BCD:
+		machine.WriteMemory(machine.m_IndexRegister, v[x] / 100);
+		machine.WriteMemory(machine.m_IndexRegister + 1, (v[x] / 10) % 10);
+		machine.WriteMemory(machine.m_IndexRegister + 2, v[x] % 10);
+		break;
+	case STORE:
+	case LOAD:
+		for (int i = 0; i <= x; i++)
+		{
+			if (Op == STORE)
+			{
+				machine.WriteMemory(machine.m_IndexRegister + i, v[i]);
+			}
+			else
+			{
+				v[i] = machine.m_Memory[(machine.m_IndexRegister + i) & 0xFFFF];
+			}
+		}
+		machine.m_IndexRegister += x + 1;
+		break;
+	case SAVE_FLAGS: copy(v, v + x + 1, machine.m_Flags.begin()); break;
+	case LOAD_FLAGS: copy(machine.m_Flags.begin(), machine.m_Flags.begin() + x + 1, v); break;
+	default: return false;
+	}
+	return true;
+}
+
+bool Decoder::Step(Chip8& machine)
+{
+	if (!machine.m_GameLoaded)
+	{
+		return true;
+	}
+	U16 opcode = machine.NextOpcode();
+	Instruction& entry = m_Table[machine.m_ProgramCounter];
+	if (entry.m_Opcode != opcode || !entry.m_Handler)
+	{
+		entry = Decode(opcode);
+		if (m_Traps[machine.m_ProgramCounter])
+		{
+			entry.m_Handler = &Trap;
+		}
+	}
+	//breakpoints only stop RunFor, a step runs the instruction under the trap and leaves the trap in place
+	Instruction untrapped;
+	const Instruction* instruction = &entry;
+	if (entry.m_Handler == &Trap)
+	{
+		untrapped = Decode(opcode);
+		instruction = &untrapped;
+	}
+	if (!instruction->m_Handler(machine, *instruction))
+	{
+		return false;
+	}
+
+	machine.m_ProgramCounter += 2;
+	machine.StepTimers(1);
+	return machine.m_ProgramCounter < machine.m_Size + Chip8::PROGRAM_STARTPOS;
+}
+
+ExitReason Decoder::RunFor(Chip8& machine, int instructions, int& executed)
+{
+	executed = 0;
+	if (!machine.m_GameLoaded)
+	{
+		return EXIT_FRAME;
+	}
+	//the same loop as Chip8::RunLoop, see there for the timers and the instructions that wait
+	int end = machine.m_Size + Chip8::PROGRAM_STARTPOS;
+	int owed = 0;
+	ExitReason reason = EXIT_FRAME;
+	for (; executed < instructions; executed++)
+	{
+		U16 pc = machine.m_ProgramCounter;
+		U16 opcode = machine.NextOpcode();
+		Instruction& instruction = m_Table[pc];
+		if (instruction.m_Opcode != opcode || !instruction.m_Handler)
+		{
+			instruction = Decode(opcode);
+			if (m_Traps[pc])
+			{
+				instruction.m_Handler = &Trap;
+			}
+		}
+		if ((opcode & 0xF000) == 0xF000)
+		{
+			machine.StepTimers(owed);
+			owed = 0;
+		}
+		if (!instruction.m_Handler(machine, instruction))
+		{
+			//only leaving the loop finds out why
+			if (instruction.m_Handler == &Trap)
+			{
+				reason = EXIT_BREAKPOINT;
+				break;
+			}
+			++executed;
+			reason = Lookup(opcode) == EXIT ? EXIT_STOPPED : EXIT_UNKNOWN_OPCODE;
+			break;
+		}
+		machine.m_ProgramCounter += 2;
+		++owed;
+
+		if (machine.m_ProgramCounter >= end)
+		{
+			++executed;
+			reason = EXIT_OUT_OF_RANGE;
+			break;
+		}
+		if (machine.m_ProgramCounter == pc && ((opcode & 0xF0FF) == 0xF00A || (opcode & 0xF000) == 0x1000))
+		{
+			owed += instructions - executed - 1;
+			executed = instructions;
+			reason = (opcode & 0xF000) == 0xF000 ? EXIT_WAITING_FOR_KEY : EXIT_FRAME;
+			break;
+		}
+	}
+	machine.StepTimers(owed);
+	return reason;
+}
+
+void Decoder::SetBreakpoint(U16 address, bool set)
+{
+	//the entry is decoded again on its next visit, with or without the trap
+	m_Traps[address] = set;
+	m_Table[address].m_Handler = nullptr;
+}
+
+bool Decoder::Trap(Chip8&, const Instruction&)
+{
+	return false;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include "Chip8.h"
+#include "Opcodes.h"
+
+using namespace std;
+
+class CodeCache;
+
+//an opcode split in its operation and operands, without anything tied to this run so it can be kept on disk
+struct DecodedOpcode
+{
+	U16 m_Opcode;
+	U8 m_Operation; //Opcodes::Operation
+	U8 m_X;
+	U8 m_Y;
+	U8 m_Unused;
+	U16 m_Value; //N, NN or NNN, whichever the operation takes
+};
+
+//the predecoded engine: every address gets its opcode decoded once into a handler with its operands,
+//later visits go straight to the handler instead of through the RunCommand switch.
+//an entry remembers the opcode it was made from, so code the game rewrites is decoded again
+class Decoder
+{
+public:
+	//changes whenever DecodedOpcode or the operations change, code caches of another version are made again
+	static const U16 VERSION = 1;
+
+	Decoder() : m_Table(0x10000), m_Traps(0x10000, false) {}
+
+	//one instruction, the same as Chip8::GameLoop, false when the game stops
+	bool Step(Chip8& machine);
+	//the same as Chip8::RunFor, stops with EXIT_BREAKPOINT before an address that has a breakpoint
+	ExitReason RunFor(Chip8& machine, int instructions, int& executed);
+	//a breakpoint is the entry of its address swapped for a trap, the loop itself never looks for them.
+	//code the game rewrites there is decoded into a trap again
+	void SetBreakpoint(U16 address, bool set);
+	//takes the decoded rom from a code cache, so no address of it has to be decoded while running
+	void Preload(const CodeCache& cache);
+
+	static DecodedOpcode Split(U16 opcode);
+
+private:
+	struct Instruction;
+	typedef bool (*Handler)(Chip8& machine, const Instruction& instruction);
+
+	struct Instruction
+	{
+		Handler m_Handler = nullptr;
+		U16 m_Opcode = 0;
+		U8 m_X = 0;
+		U8 m_Y = 0;
+		U16 m_Value = 0;
+	};
+
+	static Instruction Decode(U16 opcode) { return Bind(Split(opcode)); }
+	static Instruction Bind(const DecodedOpcode& decoded);
+	template<int Op> static bool Execute(Chip8& machine, const Instruction& instruction);
+	//stands in for the instruction at a breakpoint, runs nothing and leaves the loop
+	static bool Trap(Chip8& machine, const Instruction& instruction);
+	template<size_t... Ops> static const Handler* MakeHandlers(index_sequence<Ops...>);
+
+	vector<Instruction> m_Table;
+	vector<bool> m_Traps;
+};
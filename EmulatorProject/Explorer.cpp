@@ -0,0 +1,237 @@
+#include "Explorer.h"
+#include "Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <sstream>
+
+bool Explorer::VisitedSet::Insert(U64 hash)
+{
+	int shard = (int)(hash % SHARDS);
+	lock_guard<mutex> lock(m_Locks[shard]);
+	return m_Hashes[shard].insert(hash).second;
+}
+
+int Explorer::RunSegment(Chip8& machine, vector<bool>& coverage, int& newCode, bool& stopped)
+{
+	//run at least the decision instruction, then up to the next instruction that reads the keys
+	int count = 0;
+	stopped = false;
+	do
+	{
+		int pc = machine.m_ProgramCounter;
+		if (!coverage[pc])
+		{
+			coverage[pc] = true;
+			if (newCode < 0)
+			{
+				newCode = pc;
+			}
+		}
+		++count;
+		if (!machine.GameLoop())
+		{
+			stopped = true; //the rom stopped, nothing to explore past this
+			break;
+		}
+	} while (count < m_SegmentLength && !machine.ReadsKeys());
+	return count;
+}
+
+bool Explorer::Reaches(const Chip8& base, const vector<InputStep>& inputs, int address)
+{
+	Chip8 machine = base;
+	for (const InputStep& step : inputs)
+	{
+		machine.m_Keys = step.m_Keys;
+		for (int i = 0; i < step.m_Instructions; i++)
+		{
+			if (machine.m_ProgramCounter == address)
+			{
+				return true;
+			}
+			if (!machine.GameLoop())
+			{
+				return false;
+			}
+		}
+	}
+	return machine.m_ProgramCounter == address;
+}
+
+bool Explorer::Run(const string& path)
+{
+	Chip8 base(nullptr);
+	base.m_Muted = true;
+	if (!base.LoadGame(path))
+	{
+		Logger::Log("Could not open " + path, 0x0C);
+		return false;
+	}
+
+	ForkArena arena;
+	VisitedSet visited;
+	atomic<int> states(1);
+	vector<bool> covered(0x10000, false);
+	vector<Sequence> sequences;
+
+	//the start of the rom up to its first look at the keyboard, every sequence begins with it
+	Node root;
+	Chip8 machine = base;
+	int newCode = -1;
+	if (!machine.ReadsKeys())
+	{
+		bool stopped = false;
+		InputStep step = { 0, RunSegment(machine, covered, newCode, stopped) };
+		if (stopped)
+		{
+			Logger::Log(path + " stops before reading any keys", 0x0E);
+			return true;
+		}
+		root.m_Inputs.push_back(step);
+	}
+	arena.Capture(machine, nullptr, root.m_State);
+	visited.Insert(machine.StateHash());
+	Sequence start = { root.m_Inputs, Chip8::PROGRAM_STARTPOS };
+	sequences.push_back(start);
+
+	vector<Node> frontier;
+	frontier.push_back(root);
+
+	int threadcount = max(1, (int)thread::hardware_concurrency());
+	int depth = 0;
+	size_t peakchunks = 0;
+	for (; depth < m_MaxDepth && !frontier.empty(); ++depth)
+	{
+		atomic<size_t> next(0);
+		vector<vector<Node>> produced(threadcount);
+		vector<vector<bool>> coverage(threadcount, covered);
+		vector<vector<Sequence>> found(threadcount);
+
+		auto worker = [&](int t)
+		{
+			Chip8 child = base;
+			size_t i;
+			while ((i = next++) < frontier.size())
+			{
+				const Node& node = frontier[i];
+				arena.Restore(child, node.m_State);
+
+				//only the keys the next instruction can tell apart are worth branching on
+				vector<U16> masks;
+				U16 opcode = child.NextOpcode();
+				if ((opcode & 0xF0FF) == 0xF00A)
+				{
+					for (int key = 0; key < Chip8::AMOUNT_OF_KEYS; key++)
+					{
+						masks.push_back(1 << key);
+					}
+				}
+				else if (child.ReadsKeys())
+				{
+					masks.push_back(0);
+					masks.push_back(1 << (child.m_Registers[(opcode >> 8) & 0xF] & 0xF));
+				}
+				else
+				{
+					masks.push_back(0);
+				}
+
+				for (U16 mask : masks)
+				{
+					arena.Restore(child, node.m_State);
+					child.m_Keys = mask;
+					int reached = -1;
+					bool stopped = false;
+					int count = RunSegment(child, coverage[t], reached, stopped);
+
+					vector<InputStep> inputs = node.m_Inputs;
+					InputStep step = { mask, count };
+					inputs.push_back(step);
+					if (reached >= 0)
+					{
+						Sequence sequence = { inputs, reached };
+						found[t].push_back(sequence);
+					}
+
+					if (!stopped && states < m_MaxStates && visited.Insert(child.StateHash()))
+					{
+						++states;
+						Node created;
+						arena.Capture(child, &node.m_State, created.m_State);
+						created.m_Inputs = inputs;
+						produced[t].push_back(move(created));
+					}
+				}
+			}
+		};
+
+		vector<thread> workers;
+		for (int t = 0; t < threadcount; t++)
+		{
+			workers.push_back(thread(worker, t));
+		}
+		for (thread& w : workers)
+		{
+			w.join();
+		}
+
+		peakchunks = max(peakchunks, arena.GetChunksInUse());
+		frontier.clear();
+		for (int t = 0; t < threadcount; t++)
+		{
+			for (size_t pc = 0; pc < covered.size(); pc++)
+			{
+				if (coverage[t][pc])
+				{
+					covered[pc] = true;
+				}
+			}
+			sequences.insert(sequences.end(), found[t].begin(), found[t].end());
+			for (Node& node : produced[t])
+			{
+				frontier.push_back(move(node));
+			}
+		}
+	}
+
+	//report how much of the rom the inputs managed to reach
+	int coveredcount = 0;
+	for (size_t pc = Chip8::PROGRAM_STARTPOS; pc < covered.size(); pc++)
+	{
+		coveredcount += covered[pc] ? 1 : 0;
+	}
+	int instructions = max(1, base.m_Size / 2);
+
+	std::stringstream stream;
+	stream << std::dec << path << ": " << coveredcount << " pcs covered (" << (coveredcount * 100 / instructions)
+		<< "% of " << instructions << " instructions), " << states << " states, " << depth << " levels, "
+		<< sequences.size() << " input sequences, " << peakchunks * ForkChunk::SIZE / 1024 << " kb of states at most";
+	Logger::Log(stream.str());
+
+	//every sequence has to get to its new code again from a fresh start with the same seed, or the file is no use
+	int broken = 0;
+	for (const Sequence& sequence : sequences)
+	{
+		broken += Reaches(base, sequence.m_Inputs, sequence.m_NewCode) ? 0 : 1;
+	}
+	if (broken > 0)
+	{
+		std::stringstream failed;
+		failed << std::dec << broken << " input sequences of " << path << " do not reach their new code when replayed";
+		Logger::Log(failed.str(), 0x0C);
+	}
+
+	//the seed, then one sequence per line as keymask:instructions pairs in hex
+	ofstream out(path + ".explore.txt");
+	out << "seed " << std::hex << base.m_Random << "\n";
+	for (const Sequence& sequence : sequences)
+	{
+		for (const InputStep& step : sequence.m_Inputs)
+		{
+			out << std::hex << step.m_Keys << ":" << step.m_Instructions << " ";
+		}
+		out << "\n";
+	}
+	return broken == 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_set>
+#include "Chip8.h"
+#include "Fork.h"
+
+using namespace std;
+
+//one key decision taken by the explorer: hold these keys for this many instructions
+struct InputStep
+{
+	U16 m_Keys;
+	int m_Instructions;
+};
+
+//walks every state of a rom that can be reached by pressing keys, breadth first on all cores
+class Explorer
+{
+public:
+	Explorer(int maxStates = 20000, int maxDepth = 64, int segmentLength = 20000)
+		: m_MaxStates(maxStates), m_MaxDepth(maxDepth), m_SegmentLength(segmentLength) {};
+
+	//explores one rom, prints its pc coverage and writes the CXNN seed and the input sequences
+	//that reached new code next to the rom as <rom>.explore.txt. false when a sequence does not replay
+	bool Run(const string& path);
+
+private:
+	struct Node
+	{
+		Fork m_State; //shares the chunks it did not write with the node it was explored from
+		vector<InputStep> m_Inputs; //from the rom as it was loaded, the run up to the first key read included
+	};
+
+	//inputs that reached an address nothing before them had
+	struct Sequence
+	{
+		vector<InputStep> m_Inputs;
+		int m_NewCode;
+	};
+
+	//hashes of the states already seen, split in shards so the workers rarely wait on each other
+	class VisitedSet
+	{
+	public:
+		bool Insert(U64 hash);
+	private:
+		static const int SHARDS = 64;
+		mutex m_Locks[SHARDS];
+		unordered_set<U64> m_Hashes[SHARDS];
+	};
+
+	int m_MaxStates;
+	int m_MaxDepth;
+	int m_SegmentLength;
+
+	//returns the instructions that ran, the one that stopped the game included. newCode is the first
+	//address it reached that was not covered yet, or stays as it was
+	int RunSegment(Chip8& machine, vector<bool>& coverage, int& newCode, bool& stopped);
+	//plays inputs back from the rom as it was loaded, true when it passes the address
+	static bool Reaches(const Chip8& base, const vector<InputStep>& inputs, int address);
+};
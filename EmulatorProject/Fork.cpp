@@ -0,0 +1,166 @@
+#include "Fork.h"
+#include <cstring>
+#include <algorithm>
+
+Fork::Fork(const Fork& other)
+	: m_Arena(other.m_Arena), m_Memory(other.m_Memory), m_MemoryTop(other.m_MemoryTop), m_Screen(other.m_Screen), m_Context(other.m_Context)
+{
+	//forking is only counting the new owner of every chunk
+	for (ForkChunk* chunk : m_Memory)
+	{
+		m_Arena->Share(chunk);
+	}
+	for (ForkChunk* chunk : m_Screen)
+	{
+		if (chunk)
+		{
+			m_Arena->Share(chunk);
+		}
+	}
+}
+
+Fork::Fork(Fork&& other)
+	: m_Arena(other.m_Arena), m_Memory(move(other.m_Memory)), m_MemoryTop(other.m_MemoryTop), m_Screen(other.m_Screen), m_Context(other.m_Context)
+{
+	other.m_Memory.clear();
+	other.m_Screen.fill(nullptr);
+}
+
+Fork& Fork::operator=(Fork other)
+{
+	swap(m_Arena, other.m_Arena);
+	swap(m_Memory, other.m_Memory);
+	swap(m_MemoryTop, other.m_MemoryTop);
+	swap(m_Screen, other.m_Screen);
+	swap(m_Context, other.m_Context);
+	return *this;
+}
+
+Fork::~Fork()
+{
+	Release();
+}
+
+size_t Fork::ChunkCount() const
+{
+	return m_Memory.size() + count_if(m_Screen.begin(), m_Screen.end(), [](ForkChunk* chunk) { return chunk != nullptr; });
+}
+
+void Fork::Release()
+{
+	for (ForkChunk* chunk : m_Memory)
+	{
+		m_Arena->Free(chunk);
+	}
+	for (ForkChunk* chunk : m_Screen)
+	{
+		if (chunk)
+		{
+			m_Arena->Free(chunk);
+		}
+	}
+	m_Memory.clear();
+	m_Screen.fill(nullptr);
+}
+
+ForkChunk* ForkArena::Allocate(const U8* bytes)
+{
+	ForkChunk* chunk;
+	{
+		lock_guard<mutex> lock(m_Lock);
+		if (!m_Free)
+		{
+			//a whole slab at a time, chunks never go back to the heap before the arena does
+			m_Slabs.push_back(unique_ptr<ForkChunk[]>(new ForkChunk[m_SlabChunks]));
+			ForkChunk* slab = m_Slabs.back().get();
+			for (size_t i = 0; i < m_SlabChunks; i++)
+			{
+				slab[i].m_Next = m_Free;
+				m_Free = &slab[i];
+			}
+		}
+		chunk = m_Free;
+		m_Free = chunk->m_Next;
+	}
+	chunk->m_References = 1;
+	memcpy(chunk->m_Bytes, bytes, ForkChunk::SIZE);
+	++m_InUse;
+	return chunk;
+}
+
+ForkChunk* ForkArena::Share(ForkChunk* chunk)
+{
+	chunk->m_References.fetch_add(1, memory_order_relaxed);
+	return chunk;
+}
+
+void ForkArena::Free(ForkChunk* chunk)
+{
+	if (chunk->m_References.fetch_sub(1, memory_order_acq_rel) != 1)
+	{
+		return;
+	}
+	lock_guard<mutex> lock(m_Lock);
+	chunk->m_Next = m_Free;
+	m_Free = chunk;
+	--m_InUse;
+}
+
+void ForkArena::Capture(Chip8& machine, const Fork* parent, Fork& fork)
+{
+	Fork created;
+	created.m_Arena = this;
+	created.m_MemoryTop = machine.m_MemoryTop;
+	created.m_Memory.resize((machine.m_MemoryTop + ForkChunk::SIZE - 1) / ForkChunk::SIZE);
+	for (size_t c = 0; c < created.m_Memory.size(); c++)
+	{
+		bool dirty = ((machine.m_DirtyMemory[c >> 6] >> (c & 63)) & 1) != 0;
+		if (parent && !dirty && c < parent->m_Memory.size())
+		{
+			created.m_Memory[c] = Share(parent->m_Memory[c]);
+		}
+		else
+		{
+			created.m_Memory[c] = Allocate(&machine.m_Memory[c * ForkChunk::SIZE]);
+		}
+	}
+
+	const U8* screen = (const U8*)machine.m_ScreenBuffer.data();
+	for (int c = 0; c < Fork::SCREEN_CHUNKS; c++)
+	{
+		bool dirty = ((machine.m_DirtyScreen >> c) & 1) != 0;
+		created.m_Screen[c] = parent && !dirty ? Share(parent->m_Screen[c]) : Allocate(screen + c * ForkChunk::SIZE);
+	}
+	machine.SaveContext(created.m_Context);
+
+	//the machine now holds exactly the new fork, later writes are counted against it
+	machine.m_DirtyMemory.fill(0);
+	machine.m_DirtyScreen = 0;
+	fork = move(created);
+}
+
+void ForkArena::Restore(Chip8& machine, const Fork& fork)
+{
+	for (size_t c = 0; c < fork.m_Memory.size(); c++)
+	{
+		memcpy(&machine.m_Memory[c * ForkChunk::SIZE], fork.m_Memory[c]->m_Bytes, ForkChunk::SIZE);
+	}
+	//everything past the fork was still 0 when it was taken
+	int end = (int)fork.m_Memory.size() * ForkChunk::SIZE;
+	if (machine.m_MemoryTop > end)
+	{
+		fill(machine.m_Memory.begin() + end, machine.m_Memory.begin() + machine.m_MemoryTop, 0);
+	}
+	machine.m_MemoryTop = fork.m_MemoryTop;
+
+	U8* screen = (U8*)machine.m_ScreenBuffer.data();
+	for (int c = 0; c < Fork::SCREEN_CHUNKS; c++)
+	{
+		memcpy(screen + c * ForkChunk::SIZE, fork.m_Screen[c]->m_Bytes, ForkChunk::SIZE);
+	}
+	machine.LoadContext(fork.m_Context);
+	machine.m_DirtyMemory.fill(0);
+	machine.m_DirtyScreen = 0;
+	machine.RehashMemory();
+	machine.RehashScreen();
+}
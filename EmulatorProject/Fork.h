@@ -0,0 +1,77 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include "Chip8.h"
+
+using namespace std;
+
+class ForkArena;
+
+struct ForkChunk
+{
+	static const int SIZE = 256;
+
+	atomic<U32> m_References;
+	ForkChunk* m_Next; //free list of the arena
+	U8 m_Bytes[SIZE];
+};
+
+//a machine state whose memory and screen are kept as 256 byte chunks shared with the fork it came from.
+//copying a fork only copies chunk pointers, so thousands of variants of one machine cost what they changed
+class Fork
+{
+public:
+	Fork() {}
+	Fork(const Fork& other);
+	Fork(Fork&& other);
+	Fork& operator=(Fork other);
+	~Fork();
+
+	//chunks held, shared ones included
+	size_t ChunkCount() const;
+
+private:
+	friend class ForkArena;
+	static const int SCREEN_CHUNKS = (int)(sizeof(U64) * Chip8::PLANES * 64 * Chip8::ROW_WORDS / ForkChunk::SIZE);
+
+	void Release();
+
+	ForkArena* m_Arena = nullptr;
+	vector<ForkChunk*> m_Memory; //up to the highest address ever written, the rest is known to be 0
+	int m_MemoryTop = 0;
+	array<ForkChunk*, (size_t)SCREEN_CHUNKS> m_Screen = {};
+	Chip8Context m_Context;
+};
+
+//hands out the chunks of forks from slabs it keeps, chunks that are no longer used go back to its free list.
+//safe to use from several threads, a fork only has to be released before its arena
+class ForkArena
+{
+public:
+	ForkArena(size_t slabChunks = 1024) : m_SlabChunks(max(slabChunks, (size_t)1)) {}
+
+	//takes the state of the machine, sharing every chunk it has not written since it was restored from parent.
+	//the machine has to be restored from parent last, without parent every chunk is copied
+	void Capture(Chip8& machine, const Fork* parent, Fork& fork);
+	//puts the machine in the state of the fork, after this its writes are counted against that fork
+	void Restore(Chip8& machine, const Fork& fork);
+
+	size_t GetChunksInUse() const { return m_InUse; }
+	size_t GetChunksReserved() const { return m_Slabs.size() * m_SlabChunks; }
+
+private:
+	friend class Fork;
+
+	ForkChunk* Allocate(const U8* bytes);
+	ForkChunk* Share(ForkChunk* chunk);
+	void Free(ForkChunk* chunk);
+
+	size_t m_SlabChunks;
+	mutex m_Lock;
+	vector<unique_ptr<ForkChunk[]>> m_Slabs;
+	ForkChunk* m_Free = nullptr;
+	atomic<size_t> m_InUse{ 0 };
+};
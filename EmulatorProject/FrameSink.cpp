@@ -0,0 +1,337 @@
+#include "FrameSink.h"
+#include <cstring>
+#include <algorithm>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FRAMESINK_SSE2
+#endif
+
+//gray levels of the four plane combinations, the same as the window shows
+static const U8 PALETTE[4] = { 0, 255, 170, 85 };
+
+static array<U32, 256> MakeCrcTable()
+{
+	array<U32, 256> table;
+	for (U32 i = 0; i < 256; i++)
+	{
+		U32 c = i;
+		for (int k = 0; k < 8; k++)
+		{
+			c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		}
+		table[i] = c;
+	}
+	return table;
+}
+
+static U32 Crc32(const U8* data, size_t size, U32 crc = 0)
+{
+	//made once, sinks of a batch run write from several threads
+	static const array<U32, 256> table = MakeCrcTable();
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static void PutU32(vector<U8>& out, U32 value)
+{
+	out.push_back((U8)(value >> 24));
+	out.push_back((U8)(value >> 16));
+	out.push_back((U8)(value >> 8));
+	out.push_back((U8)value);
+}
+
+//doubles every byte of a row, factor times over, factor is a power of two
+static void Widen(const U8* source, int width, int factor, U8* target, vector<U8>& scratch)
+{
+	memcpy(target, source, width);
+	for (; factor > 1; factor /= 2, width *= 2)
+	{
+		scratch.assign(target, target + width);
+#ifdef FRAMESINK_SSE2
+		//rows are 64 or 128 pixels wide, always whole 16 byte blocks
+		for (int i = 0; i < width; i += 16)
+		{
+			__m128i bytes = _mm_loadu_si128((const __m128i*)&scratch[i]);
+			_mm_storeu_si128((__m128i*)&target[i * 2], _mm_unpacklo_epi8(bytes, bytes));
+			_mm_storeu_si128((__m128i*)&target[i * 2 + 16], _mm_unpackhi_epi8(bytes, bytes));
+		}
+#else
+		for (int i = 0; i < width; i++)
+		{
+			target[i * 2] = target[i * 2 + 1] = scratch[i];
+		}
+#endif
+	}
+}
+
+FrameSink::FrameSink(int scale, size_t queueLength) : m_Queue(max(queueLength, (size_t)1))
+{
+	m_Scale = scale >= 8 ? 8 : scale >= 4 ? 4 : scale >= 2 ? 2 : 1;
+}
+
+bool FrameSink::Open(const string& path)
+{
+	Close();
+	m_Png = path.size() >= 4 && path.compare(path.size() - 4, 4, ".png") == 0;
+	m_File.open(path, ofstream::out | ofstream::binary | ofstream::trunc);
+	if (!m_File.good())
+	{
+		return false;
+	}
+
+	int width = WIDTH * m_Scale;
+	int height = HEIGHT * m_Scale;
+	if (m_Png)
+	{
+		static const U8 signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		m_File.write((const char*)signature, sizeof(signature));
+
+		//8 bit palette image, the palette holds the four gray levels
+		vector<U8> header;
+		PutU32(header, width);
+		PutU32(header, height);
+		header.push_back(8);
+		header.push_back(3);
+		header.push_back(0);
+		header.push_back(0);
+		header.push_back(0);
+		WriteChunk("IHDR", header);
+		vector<U8> palette;
+		for (U8 gray : PALETTE)
+		{
+			palette.insert(palette.end(), 3, gray);
+		}
+		WriteChunk("PLTE", palette);
+
+		//the amount of frames is only known at the end, it gets filled in by Close
+		m_FrameCountPosition = m_File.tellp();
+		vector<U8> animation(8, 0);
+		WriteChunk("acTL", animation);
+	}
+	else
+	{
+		m_File << "YUV4MPEG2 W" << width << " H" << height << " F60:1 Ip A1:1 C420jpeg\n";
+	}
+
+	m_Head = 0;
+	m_Count = 0;
+	m_Closing = false;
+	m_Failed = false;
+	m_Frames = 0;
+	m_HasLast = false;
+	m_Repeats = 0;
+	m_Written = 0;
+	m_Sequence = 0;
+	m_Scaled.assign(width * height, 0);
+	m_Thread = thread(&FrameSink::Work, this);
+	return true;
+}
+
+void FrameSink::Submit(const Chip8& machine)
+{
+	if (!m_Thread.joinable())
+	{
+		return;
+	}
+	unique_lock<mutex> lock(m_Lock);
+	m_Emptied.wait(lock, [this] { return m_Count < m_Queue.size(); });
+	Frame& frame = m_Queue[(m_Head + m_Count) % m_Queue.size()];
+	frame.m_Width = machine.ScreenWidth();
+	frame.m_Height = machine.ScreenHeight();
+	machine.Unpack(frame.m_Pixels.data());
+	++m_Count;
+	++m_Frames;
+	lock.unlock();
+	m_Filled.notify_one();
+}
+
+bool FrameSink::Close()
+{
+	if (!m_Thread.joinable())
+	{
+		return !m_Failed;
+	}
+	{
+		lock_guard<mutex> lock(m_Lock);
+		m_Closing = true;
+	}
+	m_Filled.notify_one();
+	m_Thread.join();
+
+	if (m_Png)
+	{
+		//the last frame lasts as long as it was repeated
+		if (m_HasLast)
+		{
+			WritePngFrame(m_Repeats + 1);
+		}
+		WriteChunk("IEND", vector<U8>());
+
+		vector<U8> animation;
+		PutU32(animation, m_Written);
+		PutU32(animation, 0); //loop forever
+		m_File.seekp(m_FrameCountPosition);
+		WriteChunk("acTL", animation);
+	}
+	m_File.close();
+	m_Failed = m_Failed || m_File.fail();
+	return !m_Failed;
+}
+
+void FrameSink::Work()
+{
+	Frame frame;
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(m_Lock);
+			m_Filled.wait(lock, [this] { return m_Closing || m_Count > 0; });
+			if (m_Count == 0)
+			{
+				return;
+			}
+			frame = m_Queue[m_Head];
+			m_Head = (m_Head + 1) % m_Queue.size();
+			--m_Count;
+		}
+		m_Emptied.notify_one();
+
+		bool repeated = m_HasLast && frame.m_Width == m_Last.m_Width && frame.m_Height == m_Last.m_Height &&
+			memcmp(frame.m_Pixels.data(), m_Last.m_Pixels.data(), frame.m_Width * frame.m_Height) == 0;
+		if (repeated)
+		{
+			//y4m has no frame durations, but the scaled frame is still there to write again as it is
+			++m_Repeats;
+			if (!m_Png)
+			{
+				WriteY4m();
+			}
+			continue;
+		}
+
+		if (m_Png && m_HasLast)
+		{
+			WritePngFrame(m_Repeats + 1);
+		}
+		m_Last = frame;
+		m_HasLast = true;
+		m_Repeats = 0;
+		Scale(frame);
+		if (!m_Png)
+		{
+			WriteY4m();
+		}
+	}
+}
+
+void FrameSink::Scale(const Frame& frame)
+{
+	//every mode fills the whole video, lowres pixels just get bigger
+	int widthFactor = WIDTH / frame.m_Width * m_Scale;
+	int heightFactor = HEIGHT / frame.m_Height * m_Scale;
+	int width = WIDTH * m_Scale;
+	U8 source[WIDTH];
+	for (int y = 0; y < frame.m_Height; y++)
+	{
+		//png keeps the palette index, y4m wants the gray level, either way it is looked up before scaling
+		for (int x = 0; x < frame.m_Width; x++)
+		{
+			U8 pixel = frame.m_Pixels[y * frame.m_Width + x] & 3;
+			source[x] = m_Png ? pixel : PALETTE[pixel];
+		}
+		U8* target = &m_Scaled[y * heightFactor * width];
+		Widen(source, frame.m_Width, widthFactor, target, m_Row);
+		for (int copy = 1; copy < heightFactor; copy++)
+		{
+			memcpy(target + copy * width, target, width);
+		}
+	}
+}
+
+void FrameSink::WriteY4m()
+{
+	int size = WIDTH * m_Scale * HEIGHT * m_Scale;
+	m_File << "FRAME\n";
+
+	//the scaled frame is the luma plane, the colour planes stay neutral gray
+	m_File.write((const char*)m_Scaled.data(), size);
+	m_Row.assign(size / 2, 128);
+	m_File.write((const char*)m_Row.data(), size / 2);
+	m_Failed = m_Failed || m_File.fail();
+	++m_Written;
+}
+
+void FrameSink::WritePngFrame(int duration)
+{
+	int width = WIDTH * m_Scale;
+	int height = HEIGHT * m_Scale;
+
+	//the delay field is 16 bits, a still screen of over 18 minutes just ends early
+	duration = min(duration, 0xFFFF);
+	vector<U8> control;
+	PutU32(control, m_Sequence++);
+	PutU32(control, width);
+	PutU32(control, height);
+	PutU32(control, 0);
+	PutU32(control, 0);
+	control.push_back((U8)(duration >> 8));
+	control.push_back((U8)duration);
+	control.push_back(0);
+	control.push_back(60); //duration is in 60ths of a second
+	control.push_back(0);
+	control.push_back(0);
+	WriteChunk("fcTL", control);
+
+	//zlib stream of stored blocks, every row starts with filter type 0
+	vector<U8> raw;
+	raw.reserve((width + 1) * height);
+	for (int y = 0; y < height; y++)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), m_Scaled.begin() + y * width, m_Scaled.begin() + (y + 1) * width);
+	}
+	vector<U8> data;
+	if (m_Written > 0)
+	{
+		PutU32(data, m_Sequence++);
+	}
+	data.push_back(0x78);
+	data.push_back(0x01);
+	U32 a = 1;
+	U32 b = 0;
+	for (size_t offset = 0; offset < raw.size(); offset += 65535)
+	{
+		size_t length = min(raw.size() - offset, (size_t)65535);
+		data.push_back(offset + length == raw.size() ? 1 : 0);
+		data.push_back((U8)length);
+		data.push_back((U8)(length >> 8));
+		data.push_back((U8)~length);
+		data.push_back((U8)(~length >> 8));
+		data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + length);
+		for (size_t i = offset; i < offset + length; i++)
+		{
+			a = (a + raw[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+	}
+	PutU32(data, (b << 16) | a);
+
+	//the first frame is the normal image, the rest are frame data chunks
+	WriteChunk(m_Written > 0 ? "fdAT" : "IDAT", data);
+	++m_Written;
+}
+
+void FrameSink::WriteChunk(const char* type, const vector<U8>& data)
+{
+	vector<U8> chunk;
+	PutU32(chunk, (U32)data.size());
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	PutU32(chunk, Crc32(&chunk[4], chunk.size() - 4));
+	m_File.write((const char*)chunk.data(), chunk.size());
+	m_Failed = m_Failed || m_File.fail();
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Chip8.h"
+
+using namespace std;
+
+//records the screen after every emulated frame to a video file without a window.
+//Submit only copies the screen into a bounded queue, scaling and writing happen on the sinks own thread.
+//.y4m gives raw yuv video any encoder reads, .png gives an animated png in which repeated frames
+//become one longer frame
+class FrameSink
+{
+public:
+	//scale is rounded down to 1, 2, 4 or 8, the video is always 128x64 times the scale
+	FrameSink(int scale = 4, size_t queueLength = 64);
+	~FrameSink() { Close(); }
+
+	bool Open(const string& path);
+	//takes the screen as it is now, only waits when the writer is a whole queue behind
+	void Submit(const Chip8& machine);
+	//writes what is still queued and finishes the file, false when anything could not be written
+	bool Close();
+
+	int GetFrames() const { return m_Frames; }
+	int GetWrittenFrames() const { return m_Written; }
+
+private:
+	static const int WIDTH = 128;
+	static const int HEIGHT = 64;
+
+	struct Frame
+	{
+		array<U8, (size_t)(WIDTH * HEIGHT)> m_Pixels;
+		int m_Width;
+		int m_Height;
+	};
+
+	void Work();
+	//scales a frame to the full video size, into palette indices
+	void Scale(const Frame& frame);
+	void WriteY4m();
+	void WritePngFrame(int duration);
+	void WriteChunk(const char* type, const vector<U8>& data);
+
+	int m_Scale;
+	bool m_Png = false;
+	ofstream m_File;
+	bool m_Failed = false;
+
+	//ring of frames between Submit and the writer
+	vector<Frame> m_Queue;
+	size_t m_Head = 0;
+	size_t m_Count = 0;
+	bool m_Closing = false;
+	thread m_Thread;
+	mutex m_Lock;
+	condition_variable m_Filled;
+	condition_variable m_Emptied;
+	int m_Frames = 0;
+
+	//writer side
+	Frame m_Last;
+	bool m_HasLast = false;
+	int m_Repeats = 0; //times the last frame was submitted again
+	vector<U8> m_Scaled;
+	vector<U8> m_Row;
+	int m_Written = 0;
+	U32 m_Sequence = 0;
+	streampos m_FrameCountPosition;
+};
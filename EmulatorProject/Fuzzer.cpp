@@ -0,0 +1,92 @@
+//libFuzzer target for the instruction core, not part of the normal build.
+//Build it headless with the sanitizers, for example with clang:
+//	clang++ -std=c++14 -O1 -g -fsanitize=fuzzer,address,undefined -DCHIP8_HEADLESS Fuzzer.cpp Chip8.cpp Opcodes.cpp -o chip8_fuzzer
+//and run it with ./chip8_fuzzer -max_len=4096 corpus/
+#include "Chip8.h"
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+//every allocation of the process is counted, running instructions must never make one.
+//atomic since the fuzzer's own threads allocate too
+static atomic<size_t> allocations(0);
+
+void* operator new(size_t size)
+{
+	++allocations;
+	void* memory = malloc(size ? size : 1);
+	if (!memory)
+	{
+		throw bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+//input layout: one byte with the amount of frames, two bytes of key mask per frame, the rest is the rom
+static const int MAX_FRAMES = 16;
+static const int INSTRUCTIONS_PER_FRAME = 500;
+
+extern "C" int LLVMFuzzerTestOneInput(const U8* data, size_t size)
+{
+	//one machine for the whole run, LoadRom resets everything a previous input could have touched
+	static Chip8 machine(nullptr);
+	machine.m_Muted = true;
+
+	if (size < 1)
+	{
+		return 0;
+	}
+	int frames = (data[0] % MAX_FRAMES) + 1;
+	size_t header = 1 + frames * 2;
+	if (size < header)
+	{
+		return 0;
+	}
+
+	if (!machine.LoadRom(data + header, size - header))
+	{
+		return 0;
+	}
+
+	//loading may allocate, stepping may not, a failing check shows up as a crash
+	size_t before = allocations;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		machine.m_Keys = data[1 + frame * 2] | (data[2 + frame * 2] << 8);
+		int executed = 0;
+		if (Stops(machine.RunFor(INSTRUCTIONS_PER_FRAME, executed)))
+		{
+			break;
+		}
+	}
+	if (allocations != before)
+	{
+		abort();
+	}
+	return 0;
+}
@@ -0,0 +1,216 @@
+#include "Headless.h"
+#include "Archive.h"
+#include "Logger.h"
+#include "FrameSink.h"
+#include "Decoder.h"
+#include "CodeCache.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <sstream>
+#include <iomanip>
+#include <fstream>
+#include <cstdio>
+#include <cctype>
+
+//the CXNN seed of sequences from a file without a seed line
+static const U32 SEED = 0x2C8;
+
+vector<string> HeadlessRunner::Expand(const vector<string>& paths)
+{
+	vector<string> roms;
+	for (const string& path : paths)
+	{
+		string archivepath;
+		string member;
+		if (Archive::IsArchive(path) && !Archive::SplitPath(path, archivepath, member))
+		{
+			shared_ptr<Archive> archive = Archive::Open(path);
+			if (archive)
+			{
+				for (const string& name : archive->Members())
+				{
+					roms.push_back(path + ":" + name);
+				}
+				continue;
+			}
+		}
+		roms.push_back(path);
+	}
+	return roms;
+}
+
+bool HeadlessRunner::Run(const vector<string>& paths)
+{
+	vector<string> roms = Expand(paths);
+	vector<U64> hashes(roms.size(), 0);
+	vector<U8> loaded(roms.size(), 0); //a byte per rom, the workers write them at the same time
+
+	atomic<size_t> next(0);
+	auto worker = [&]()
+	{
+		Chip8 machine(nullptr);
+		machine.m_Muted = true;
+		FrameSink sink(m_CaptureScale);
+		bool predecoded = !m_CodeCacheFolder.empty();
+		unique_ptr<Decoder> decoder(predecoded ? new Decoder() : nullptr);
+		CodeCache cache(m_CodeCacheFolder);
+		size_t i;
+		while ((i = next++) < roms.size())
+		{
+			if (!machine.LoadGame(roms[i]))
+			{
+				continue;
+			}
+			loaded[i] = 1;
+			if (predecoded)
+			{
+				if (!cache.Open(machine.m_Rom))
+				{
+					Logger::Log("could not write the code cache of " + roms[i], 0x0C);
+				}
+				decoder->Preload(cache);
+			}
+			bool capturing = !m_CaptureTarget.empty() && sink.Open(CapturePath(roms[i]));
+			bool running = true;
+			for (int frame = 0; frame < m_Frames && running; frame++)
+			{
+				int executed = 0;
+				ExitReason reason = predecoded ? decoder->RunFor(machine, m_InstructionsPerFrame, executed)
+					: machine.RunFor(m_InstructionsPerFrame, executed);
+				running = !Stops(reason);
+				if (capturing)
+				{
+					sink.Submit(machine);
+				}
+			}
+			if (capturing && !sink.Close())
+			{
+				Logger::Log("could not write " + CapturePath(roms[i]), 0x0C);
+			}
+			hashes[i] = machine.Hash();
+		}
+	};
+
+	int threadcount = max(1, (int)thread::hardware_concurrency());
+	vector<thread> workers;
+	for (int t = 0; t < threadcount; t++)
+	{
+		workers.push_back(thread(worker));
+	}
+	for (thread& w : workers)
+	{
+		w.join();
+	}
+
+	//printed in the order the roms were given so runs can be compared line by line
+	bool allLoaded = true;
+	for (size_t i = 0; i < roms.size(); i++)
+	{
+		std::stringstream stream;
+		if (loaded[i])
+		{
+			stream << std::hex << std::setfill('0') << std::setw(16) << hashes[i] << " " << roms[i];
+			Logger::Log(stream.str());
+		}
+		else
+		{
+			Logger::Log("could not load " + roms[i], 0x0C);
+			allLoaded = false;
+		}
+	}
+	return allLoaded;
+}
+
+string HeadlessRunner::CapturePath(const string& rom) const
+{
+	//the whole path goes in the name, two packs can hold roms with the same file name
+	string name = rom;
+	for (char& c : name)
+	{
+		if (!isalnum((unsigned char)c) && c != '.' && c != '-')
+		{
+			c = '_';
+		}
+	}
+	name.erase(0, name.find_first_not_of("._"));
+	return m_CaptureTarget + "/" + name + m_CaptureExtension;
+}
+
+bool HeadlessRunner::Replay(const string& rom, const string& inputs)
+{
+	Chip8 machine(nullptr);
+	machine.m_Muted = true;
+	if (!machine.LoadGame(rom))
+	{
+		Logger::Log("could not load " + rom, 0x0C);
+		return false;
+	}
+	ifstream file(inputs);
+	if (!file.good())
+	{
+		Logger::Log("could not open " + inputs, 0x0C);
+		return false;
+	}
+
+	FrameSink sink(m_CaptureScale);
+	bool capturing = !m_CaptureTarget.empty();
+	if (capturing && !sink.Open(m_CaptureTarget))
+	{
+		Logger::Log("could not write " + m_CaptureTarget, 0x0C);
+		return false;
+	}
+
+	string line;
+	int sequences = 0;
+	U32 seed = SEED;
+	while (getline(file, line))
+	{
+		//the seed the explorer ran with, CXNN has to draw the same numbers for the sequences to go the same way
+		if (line.compare(0, 5, "seed ") == 0)
+		{
+			if (sscanf(line.c_str() + 5, "%x", &seed) != 1)
+			{
+				Logger::Log("bad seed " + line + " in " + inputs, 0x0C);
+				return false;
+			}
+			continue;
+		}
+
+		//every sequence starts from the rom as it was loaded
+		machine.LoadRom(machine.m_Rom.data(), machine.m_Rom.size());
+		machine.m_Random = seed;
+		std::stringstream steps(line);
+		string step;
+		int instructions = 0;
+		bool running = true;
+		while (running && steps >> step)
+		{
+			U16 keys = 0;
+			unsigned count = 0;
+			if (sscanf(step.c_str(), "%hx:%x", &keys, &count) != 2)
+			{
+				Logger::Log("bad input step " + step + " in " + inputs, 0x0C);
+				return false;
+			}
+			machine.m_Keys = keys;
+			for (unsigned i = 0; i < count && running; i++)
+			{
+				running = machine.GameLoop();
+				//frames are cut at the same instruction counts as a batch run
+				if (++instructions % m_InstructionsPerFrame == 0 && capturing)
+				{
+					sink.Submit(machine);
+				}
+			}
+		}
+		++sequences;
+	}
+
+	bool written = !capturing || sink.Close();
+	std::stringstream stream;
+	stream << std::dec << sequences << " sequences replayed, " << sink.GetFrames() << " frames captured, "
+		<< sink.GetWrittenFrames() << " written";
+	Logger::Log(stream.str());
+	return written;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Chip8.h"
+
+using namespace std;
+
+//runs roms without a window for a fixed amount of frames and prints the hash of where they end up,
+//spread over all cores so a whole rom pack goes through in one go
+class HeadlessRunner
+{
+public:
+	HeadlessRunner(int frames, int instructionsPerFrame = 5)
+		: m_Frames(frames), m_InstructionsPerFrame(instructionsPerFrame) {};
+
+	//archives without a member name stand for every rom inside them
+	static vector<string> Expand(const vector<string>& paths);
+
+	//false when any rom could not be loaded
+	bool Run(const vector<string>& paths);
+	//plays back every input sequence of an explorer file (keymask:instructions pairs in hex, one sequence per line)
+	//from a fresh start, one after the other. a "seed <hex>" line sets the CXNN seed of the sequences after it
+	bool Replay(const string& rom, const string& inputs);
+
+	//records every frame, to <target>/<rom name><extension> for Run and to target itself for Replay
+	void SetCapture(const string& target, const string& extension, int scale)
+	{
+		m_CaptureTarget = target; m_CaptureExtension = extension; m_CaptureScale = scale;
+	}
+	//runs on the predecoded engine with every rom decoded ahead from a code cache in folder
+	void SetCodeCache(const string& folder) { m_CodeCacheFolder = folder; }
+
+private:
+	string CapturePath(const string& rom) const;
+
+	int m_Frames;
+	int m_InstructionsPerFrame;
+	string m_CaptureTarget;
+	string m_CaptureExtension = ".y4m";
+	int m_CaptureScale = 4;
+	string m_CodeCacheFolder;
+};
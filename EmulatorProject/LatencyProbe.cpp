@@ -0,0 +1,113 @@
+#include "LatencyProbe.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+void Histogram::Add(double seconds)
+{
+	double ms = seconds * 1000.0;
+	size_t bucket = min((size_t)max(ms / m_BucketMs, 0.0), m_Counts.size() - 1);
+	++m_Counts[bucket];
+	++m_Total;
+	m_MaxMs = max(m_MaxMs, ms);
+}
+
+double Histogram::Percentile(double fraction) const
+{
+	int needed = (int)(fraction * m_Total + 0.5);
+	int seen = 0;
+	for (size_t i = 0; i < m_Counts.size(); i++)
+	{
+		seen += m_Counts[i];
+		if (seen >= needed && seen > 0)
+		{
+			//the overflow bucket has no upper end, the largest sample is the best there is
+			return i + 1 == m_Counts.size() ? m_MaxMs : (i + 1) * m_BucketMs;
+		}
+	}
+	return 0.0;
+}
+
+string Histogram::Json() const
+{
+	size_t used = m_Counts.size();
+	while (used > 0 && m_Counts[used - 1] == 0)
+	{
+		--used;
+	}
+	std::stringstream json;
+	json << std::dec << "{\"bucket_ms\":" << m_BucketMs << ",\"counts\":[";
+	for (size_t i = 0; i < used; i++)
+	{
+		json << (i > 0 ? "," : "") << m_Counts[i];
+	}
+	json << "]}";
+	return json.str();
+}
+
+//latencies in 1 ms steps up to 250 ms, frame intervals in 0.25 ms steps up to 100 ms
+LatencyProbe::LatencyProbe() : m_Latency(1.0, 250), m_ReadDelay(1.0, 250), m_DrawDelay(1.0, 250), m_SwapDelay(1.0, 250), m_FrameIntervals(0.25, 400)
+{
+}
+
+void LatencyProbe::SampleKeys(const Chip8& machine)
+{
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	U16 pressed = machine.m_Keys & ~m_LastKeys;
+	m_LastKeys = machine.m_Keys;
+
+	if (m_Stage != IDLE && Metrics::Seconds(m_Pressed, now) > 1.0)
+	{
+		++m_Abandoned;
+		m_Stage = IDLE;
+	}
+	if (m_Stage != IDLE || pressed == 0)
+	{
+		return;
+	}
+	//the lowest key when more went down at once
+	m_Key = pressed & (U16)-(short)pressed;
+	m_Pressed = now;
+	m_Screen = machine.m_ScreenBuffer;
+	m_Stage = PRESSED;
+}
+
+void LatencyProbe::Observe(Chip8& machine)
+{
+	if (m_Stage == PRESSED && (machine.m_KeysRead & m_Key) != 0)
+	{
+		m_Observed = chrono::steady_clock::now();
+		m_ReadDelay.Add(Metrics::Seconds(m_Pressed, m_Observed));
+		m_Stage = OBSERVED;
+	}
+	machine.m_KeysRead = 0;
+}
+
+void LatencyProbe::Present(const Chip8& machine)
+{
+	if (m_Stage == OBSERVED && machine.m_ScreenBuffer != m_Screen)
+	{
+		m_Changed = chrono::steady_clock::now();
+		m_DrawDelay.Add(Metrics::Seconds(m_Observed, m_Changed));
+		m_Stage = CHANGED;
+	}
+}
+
+void LatencyProbe::Swapped()
+{
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	if (m_Swapped)
+	{
+		m_FrameIntervals.Add(Metrics::Seconds(m_LastSwap, now));
+	}
+	m_LastSwap = now;
+	m_Swapped = true;
+
+	if (m_Stage == CHANGED)
+	{
+		m_SwapDelay.Add(Metrics::Seconds(m_Changed, now));
+		m_Latency.Add(Metrics::Seconds(m_Pressed, now));
+		m_Stage = IDLE;
+	}
+}
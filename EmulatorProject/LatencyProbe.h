@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <chrono>
+#include "Chip8.h"
+
+using namespace std;
+
+//counts samples in fixed width buckets, the last bucket holds everything past the others
+class Histogram
+{
+public:
+	Histogram(double bucketMs, int buckets) : m_BucketMs(bucketMs), m_Counts(buckets + 1, 0) {}
+
+	void Add(double seconds);
+	int GetCount() const { return m_Total; }
+	double GetMaxMs() const { return m_MaxMs; }
+	//the upper end of the bucket below which this fraction of the samples fell, in milliseconds
+	double Percentile(double fraction) const;
+	//{"bucket_ms":..,"counts":[..]}, without the empty buckets at the end
+	string Json() const;
+
+private:
+	double m_BucketMs;
+	vector<int> m_Counts;
+	int m_Total = 0;
+	double m_MaxMs = 0.0;
+};
+
+//follows one key press at a time through the frame loop: sampled from the keyboard, read by EX9E, EXA1 or FX0A,
+//the first shown screen that differs from the one at the press, and the swap that put it on screen.
+//the frame loop calls the four steps in this order, run-ahead frames are observed and shown like real ones
+class LatencyProbe
+{
+public:
+	LatencyProbe();
+
+	//a key that went down starts a measurement, unless one is still open
+	void SampleKeys(const Chip8& machine);
+	//after instructions ran, the key counts as seen once the game read it
+	void Observe(Chip8& machine);
+	//the machine as it is about to be shown
+	void Present(const Chip8& machine);
+	//after the frame was swapped, closes the measurement and the interval since the last swap
+	void Swapped();
+
+	//press to swap, the whole latency
+	const Histogram& GetLatency() const { return m_Latency; }
+	//press to the game reading the key
+	const Histogram& GetReadDelay() const { return m_ReadDelay; }
+	//read to the first changed frame
+	const Histogram& GetDrawDelay() const { return m_DrawDelay; }
+	//changed frame to its swap
+	const Histogram& GetSwapDelay() const { return m_SwapDelay; }
+	const Histogram& GetFrameIntervals() const { return m_FrameIntervals; }
+	//presses the game never read or never showed, given up after a second
+	int GetAbandoned() const { return m_Abandoned; }
+
+private:
+	enum Stage { IDLE, PRESSED, OBSERVED, CHANGED };
+
+	Stage m_Stage = IDLE;
+	U16 m_Key = 0;
+	U16 m_LastKeys = 0;
+	chrono::steady_clock::time_point m_Pressed;
+	chrono::steady_clock::time_point m_Observed;
+	chrono::steady_clock::time_point m_Changed;
+	chrono::steady_clock::time_point m_LastSwap;
+	bool m_Swapped = false;
+	array<U64, (size_t)(Chip8::PLANES * 64 * Chip8::ROW_WORDS)> m_Screen; //at the press
+	int m_Abandoned = 0;
+
+	Histogram m_Latency;
+	Histogram m_ReadDelay;
+	Histogram m_DrawDelay;
+	Histogram m_SwapDelay;
+	Histogram m_FrameIntervals;
+};
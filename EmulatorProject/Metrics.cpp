@@ -0,0 +1,166 @@
+#include "UnixSocket.h"
+#include "Metrics.h"
+#include "Logger.h"
+#include "LatencyProbe.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+Metrics::~Metrics()
+{
+	if (m_Socket != ~0ULL)
+	{
+		closesocket((SOCKET)m_Socket);
+	}
+}
+
+bool Metrics::Open(const string& target)
+{
+	if (target.compare(0, 5, "unix:") == 0)
+	{
+		m_SocketPath = target.substr(5);
+		return StartWinsock() && m_SocketPath.size() < sizeof(UnixAddress::sun_path);
+	}
+	m_File.open(target, ofstream::out | ofstream::app);
+	return m_File.good();
+}
+
+bool Metrics::Send(const string& line)
+{
+	if (m_File.is_open())
+	{
+		m_File << line << endl;
+		return m_File.good();
+	}
+	if (m_SocketPath.empty())
+	{
+		return false;
+	}
+
+	//(re)connect lazily so the collector can be started after the emulator
+	if (m_Socket == ~0ULL)
+	{
+		SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (s == INVALID_SOCKET)
+		{
+			return false;
+		}
+		UnixAddress address = {};
+		address.sun_family = AF_UNIX;
+		strncpy_s(address.sun_path, m_SocketPath.c_str(), sizeof(address.sun_path) - 1);
+		if (connect(s, (sockaddr*)&address, sizeof(address)) != 0)
+		{
+			closesocket(s);
+			return false;
+		}
+		m_Socket = s;
+	}
+
+	string data = line + "\n";
+	if (send((SOCKET)m_Socket, data.c_str(), (int)data.size(), 0) != (int)data.size())
+	{
+		closesocket((SOCKET)m_Socket);
+		m_Socket = ~0ULL;
+		return false;
+	}
+	return true;
+}
+
+void Metrics::EndFrame()
+{
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double frametime = Seconds(m_LastFrame, now);
+	m_LastFrame = now;
+	++m_Frames;
+	m_MaxFrameTime = max(m_MaxFrameTime, frametime);
+
+	//a frame that took longer than one and a half vsyncs missed at least one
+	if (frametime > 1.5 / 60.0)
+	{
+		m_DroppedFrames += (int)(frametime * 60.0 + 0.5) - 1;
+	}
+
+	double elapsed = Seconds(m_Start, now);
+	if (elapsed >= m_Interval)
+	{
+		Publish(elapsed);
+		m_Start = now;
+		m_Instructions = 0;
+		m_Frames = 0;
+		m_DroppedFrames = 0;
+		m_SkippedRenders = 0;
+		m_UploadTime = 0.0;
+		m_IdleTime = 0.0;
+		m_RunAheadTime = 0.0;
+		m_MaxFrameTime = 0.0;
+	}
+}
+
+void Metrics::Publish(double elapsed)
+{
+	double ips = m_Instructions / elapsed;
+	double fps = m_Frames / elapsed;
+	//emulated frames against the 60 frames the wall clock allowed for
+	double ratio = m_Frames / (elapsed * 60.0);
+	double frameMs = elapsed * 1000.0 / m_Frames;
+	double uploadMs = m_UploadTime * 1000.0 / m_Frames;
+	double idle = m_IdleTime * 100.0 / elapsed;
+	int runaheadUs = (int)(m_RunAheadTime * 1000000.0 / m_Frames);
+
+	std::stringstream stream;
+	stream << std::dec << std::fixed << std::setprecision(3) << "mips " << ips / 1000000.0 << " fps " << fps
+		<< " frame " << frameMs << " ms upload " << uploadMs << " ms idle " << idle << "% dropped " << m_DroppedFrames << " skipped " << m_SkippedRenders
+		<< " runahead " << m_RunAheadFrames << " frames, overhead " << runaheadUs << " us/frame";
+	if (m_Latency != nullptr && m_Latency->GetLatency().GetCount() > 0)
+	{
+		const Histogram& latency = m_Latency->GetLatency();
+		stream << " latency p50 " << latency.Percentile(0.5) << " p99 " << latency.Percentile(0.99) << " ms of " << latency.GetCount() << " presses";
+	}
+	Logger::Log(stream.str());
+
+	if (m_File.is_open() || !m_SocketPath.empty())
+	{
+		std::stringstream json;
+		json << std::dec << std::fixed << std::setprecision(3)
+			<< "{\"instructions_per_second\":" << ips
+			<< ",\"frames_per_second\":" << fps
+			<< ",\"emulated_wall_ratio\":" << ratio
+			<< ",\"frame_ms\":" << frameMs
+			<< ",\"frame_ms_max\":" << m_MaxFrameTime * 1000.0
+			<< ",\"upload_ms\":" << uploadMs
+			<< ",\"dropped_frames\":" << m_DroppedFrames
+			<< ",\"skipped_renders\":" << m_SkippedRenders
+			<< ",\"idle_percent\":" << idle
+			<< ",\"runahead_frames\":" << m_RunAheadFrames
+			<< ",\"runahead_us\":" << runaheadUs;
+		if (m_Latency != nullptr)
+		{
+			const Histogram& latency = m_Latency->GetLatency();
+			const Histogram& intervals = m_Latency->GetFrameIntervals();
+			json << ",\"latency\":{\"presses\":" << latency.GetCount()
+				<< ",\"abandoned\":" << m_Latency->GetAbandoned()
+				<< ",\"p50_ms\":" << latency.Percentile(0.5)
+				<< ",\"p99_ms\":" << latency.Percentile(0.99)
+				<< ",\"max_ms\":" << latency.GetMaxMs()
+				<< ",\"total\":" << latency.Json()
+				<< ",\"read\":" << m_Latency->GetReadDelay().Json()
+				<< ",\"draw\":" << m_Latency->GetDrawDelay().Json()
+				<< ",\"swap\":" << m_Latency->GetSwapDelay().Json() << "}"
+				<< ",\"frame_interval\":{\"p50_ms\":" << intervals.Percentile(0.5)
+				<< ",\"p99_ms\":" << intervals.Percentile(0.99)
+				<< ",\"max_ms\":" << intervals.GetMaxMs()
+				<< ",\"histogram\":" << intervals.Json() << "}";
+		}
+		json << "}";
+		Send(json.str());
+	}
+
+	if (m_Window != nullptr)
+	{
+		std::stringstream title;
+		title << std::fixed << std::setprecision(2) << ips / 1000000.0 << " MIPS  " << frameMs << " ms/frame  "
+			<< uploadMs << " ms upload  " << (int)idle << "% idle";
+		glfwSetWindowTitle(m_Window, title.str().c_str());
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <chrono>
+
+using namespace std;
+
+struct GLFWwindow;
+class LatencyProbe;
+
+//collects how fast the emulator runs and publishes it once per interval,
+//always as a stats line on the console and optionally as json lines to a file or unix socket
+class Metrics
+{
+public:
+	Metrics() : m_Start(chrono::steady_clock::now()), m_LastFrame(m_Start) {};
+	~Metrics();
+
+	//target is a file path, or unix:<path> to send to a listening unix domain socket
+	bool Open(const string& target);
+	//show the headline numbers in the title of this window
+	void SetTitleOverlay(GLFWwindow* window) { m_Window = window; }
+	void SetInterval(double seconds) { m_Interval = seconds; }
+	//publishes the key latency and frame interval histograms of this probe as well, they count from the start
+	void SetLatency(const LatencyProbe* probe) { m_Latency = probe; }
+
+	void AddInstructions(int count) { m_Instructions += count; }
+	void AddUploadTime(double seconds) { m_UploadTime += seconds; }
+	void AddIdleTime(double seconds) { m_IdleTime += seconds; }
+	void AddRunAheadTime(double seconds, int frames) { m_RunAheadTime += seconds; m_RunAheadFrames = frames; }
+	void AddSkippedRender() { ++m_SkippedRenders; }
+	//closes the current frame and publishes when the interval is over
+	void EndFrame();
+
+	static double Seconds(chrono::steady_clock::time_point from, chrono::steady_clock::time_point to)
+	{
+		return chrono::duration<double>(to - from).count();
+	}
+
+private:
+	void Publish(double elapsed);
+	bool Send(const string& line);
+
+	chrono::steady_clock::time_point m_Start;
+	chrono::steady_clock::time_point m_LastFrame;
+	double m_Interval = 1.0;
+
+	long long m_Instructions = 0;
+	int m_Frames = 0;
+	int m_DroppedFrames = 0;
+	int m_SkippedRenders = 0;
+	double m_UploadTime = 0.0;
+	double m_IdleTime = 0.0;
+	double m_RunAheadTime = 0.0;
+	int m_RunAheadFrames = 0;
+	double m_MaxFrameTime = 0.0;
+
+	GLFWwindow* m_Window = nullptr;
+	const LatencyProbe* m_Latency = nullptr;
+	ofstream m_File;
+	string m_SocketPath;
+	unsigned long long m_Socket = ~0ULL; //SOCKET, kept opaque so winsock stays out of the header
+};
@@ -0,0 +1,181 @@
+#include "MonitorView.h"
+#include <cmath>
+
+//one quad per instance, placed by its tile and using only the part of the tile the screen mode fills
+static const GLchar* wallVertexSource =
+"#version 150 core\n"
+"in vec2 corner;"
+"in vec4 tile;"
+"uniform vec2 grid;"
+"out vec2 Texcoord;"
+"void main() {"
+"   Texcoord = (tile.xy + corner * tile.zw) / grid;"
+"   vec2 position = (tile.xy + corner) / grid;"
+"   gl_Position = vec4(position.x * 2.0 - 1.0, 1.0 - position.y * 2.0, 0.0, 1.0);"
+"}";
+
+//the atlas holds the raw plane bits of the machines, 0 is off and 1, 2 and 3 get darker
+static const GLchar* wallFragmentSource =
+"#version 150 core\n"
+"in vec2 Texcoord;"
+"out vec4 outColor;"
+"uniform sampler2D atlas;"
+"void main() {"
+"   float color = texture(atlas, Texcoord).r * 255.0;"
+"   outColor = vec4(vec3(color < 0.5 ? 0.0 : 1.0 - (color - 1.0) / 3.0), 1.0);"
+"}";
+
+MonitorView::MonitorView(int count) : m_Count(count)
+{
+	m_Columns = (int)ceil(sqrt((double)count));
+	m_Rows = (count + m_Columns - 1) / m_Columns;
+	m_Shown.resize(count);
+	m_ShownMode.resize(count, -1);
+	m_Uploaded.resize(count, false);
+}
+
+bool MonitorView::Initialize()
+{
+	if (m_Program != 0)
+	{
+		return true;
+	}
+
+	glGenVertexArrays(1, &m_Vao);
+	glBindVertexArray(m_Vao);
+
+	//the corners of a tile, shared by every instance
+	float corners[] = {
+		0.0f, 0.0f,		1.0f, 0.0f,		0.0f, 1.0f,
+		0.0f, 1.0f,		1.0f, 0.0f,		1.0f, 1.0f
+	};
+	glGenBuffers(1, &m_QuadVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, m_QuadVbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &wallVertexSource, NULL);
+	glCompileShader(vertexShader);
+	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShader, 1, &wallFragmentSource, NULL);
+	glCompileShader(fragmentShader);
+
+	m_Program = glCreateProgram();
+	glAttachShader(m_Program, vertexShader);
+	glAttachShader(m_Program, fragmentShader);
+	glBindFragDataLocation(m_Program, 0, "outColor");
+	glLinkProgram(m_Program);
+	glDetachShader(m_Program, vertexShader);
+	glDetachShader(m_Program, fragmentShader);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint status;
+	glGetProgramiv(m_Program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		Shutdown();
+		return false;
+	}
+	glUseProgram(m_Program);
+	glUniform2f(glGetUniformLocation(m_Program, "grid"), (float)m_Columns, (float)m_Rows);
+
+	GLint cornerAttrib = glGetAttribLocation(m_Program, "corner");
+	glVertexAttribPointer(cornerAttrib, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+	glEnableVertexAttribArray(cornerAttrib);
+
+	//per instance: column, row and how much of the tile width and height the screen uses
+	vector<float> tiles(m_Count * 4);
+	for (int i = 0; i < m_Count; i++)
+	{
+		tiles[i * 4 + 0] = (float)(i % m_Columns);
+		tiles[i * 4 + 1] = (float)(i / m_Columns);
+		tiles[i * 4 + 2] = 0.5f;
+		tiles[i * 4 + 3] = 0.5f;
+	}
+	glGenBuffers(1, &m_TileVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, m_TileVbo);
+	glBufferData(GL_ARRAY_BUFFER, tiles.size() * sizeof(float), tiles.data(), GL_DYNAMIC_DRAW);
+	GLint tileAttrib = glGetAttribLocation(m_Program, "tile");
+	glVertexAttribPointer(tileAttrib, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+	glVertexAttribDivisor(tileAttrib, 1);
+	glEnableVertexAttribArray(tileAttrib);
+
+	//one byte per pixel holding the plane bits
+	glGenTextures(1, &m_Atlas);
+	glBindTexture(GL_TEXTURE_2D, m_Atlas);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	vector<U8> empty(m_Columns * TILE_WIDTH * m_Rows * TILE_HEIGHT, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, m_Columns * TILE_WIDTH, m_Rows * TILE_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, empty.data());
+
+	return true;
+}
+
+void MonitorView::Shutdown()
+{
+	if (m_Atlas != 0)
+	{
+		glDeleteTextures(1, &m_Atlas);
+	}
+	if (m_Program != 0)
+	{
+		glDeleteProgram(m_Program);
+	}
+	if (m_TileVbo != 0)
+	{
+		glDeleteBuffers(1, &m_TileVbo);
+	}
+	if (m_QuadVbo != 0)
+	{
+		glDeleteBuffers(1, &m_QuadVbo);
+	}
+	if (m_Vao != 0)
+	{
+		glDeleteVertexArrays(1, &m_Vao);
+	}
+	m_Atlas = m_Program = m_TileVbo = m_QuadVbo = m_Vao = 0;
+}
+
+void MonitorView::Update(const vector<Chip8*>& machines)
+{
+	glBindTexture(GL_TEXTURE_2D, m_Atlas);
+	glBindBuffer(GL_ARRAY_BUFFER, m_TileVbo);
+	m_UploadedTiles = 0;
+
+	for (int i = 0; i < m_Count && i < (int)machines.size(); i++)
+	{
+		const Chip8& machine = *machines[i];
+		int width = machine.ScreenWidth();
+		int height = machine.ScreenHeight();
+		int mode = width * 1000 + height;
+
+		if (mode != m_ShownMode[i] || !m_Uploaded[i])
+		{
+			float used[2] = { (float)width / TILE_WIDTH, (float)height / TILE_HEIGHT };
+			glBufferSubData(GL_ARRAY_BUFFER, (i * 4 + 2) * sizeof(float), sizeof(used), used);
+			m_ShownMode[i] = mode;
+		}
+		else if (m_Shown[i] == machine.m_ScreenBuffer)
+		{
+			continue; //nothing changed, the tile in the atlas is still right
+		}
+
+		m_Shown[i] = machine.m_ScreenBuffer;
+		m_Uploaded[i] = true;
+		U8 pixels[TILE_WIDTH * TILE_HEIGHT];
+		machine.Unpack(pixels);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, (i % m_Columns) * TILE_WIDTH, (i / m_Columns) * TILE_HEIGHT,
+			width, height, GL_RED, GL_UNSIGNED_BYTE, pixels);
+		++m_UploadedTiles;
+	}
+}
+
+void MonitorView::Present()
+{
+	glBindVertexArray(m_Vao);
+	glUseProgram(m_Program);
+	glBindTexture(GL_TEXTURE_2D, m_Atlas);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 6, m_Count);
+}
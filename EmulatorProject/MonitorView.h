@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <glad/glad.h>
+#include "Chip8.h"
+
+using namespace std;
+
+//shows the screens of many machines as a grid in one window: all screens share one atlas texture,
+//only screens that changed are uploaded and the whole grid is a single instanced draw
+class MonitorView
+{
+public:
+	//big enough for the widest mode, narrower screens use the left part and lowres the top half
+	static const int TILE_WIDTH = 128;
+	static const int TILE_HEIGHT = 64;
+
+	MonitorView(int count);
+	~MonitorView() { Shutdown(); }
+
+	bool Initialize();
+	void Shutdown();
+
+	//uploads the tiles of machines whose screen or resolution changed since the last update
+	void Update(const vector<Chip8*>& machines);
+	void Present();
+
+	int GetUploadedTiles() const { return m_UploadedTiles; }
+	int GetColumns() const { return m_Columns; }
+	int GetRows() const { return m_Rows; }
+
+private:
+	int m_Count;
+	int m_Columns;
+	int m_Rows;
+	int m_UploadedTiles = 0;
+
+	//what each tile showed at the last upload, to find the ones that changed
+	vector<array<U64, Chip8::PLANES * 64 * Chip8::ROW_WORDS>> m_Shown;
+	vector<int> m_ShownMode;
+	vector<bool> m_Uploaded;
+
+	GLuint m_Vao = 0;
+	GLuint m_QuadVbo = 0;
+	GLuint m_TileVbo = 0;
+	GLuint m_Program = 0;
+	GLuint m_Atlas = 0;
+};
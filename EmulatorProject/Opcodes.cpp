@@ -0,0 +1,68 @@
+#include "Opcodes.h"
+
+namespace Opcodes
+{
+	array<U8, (size_t)0x10000> MakeOperations()
+	{
+		array<U8, (size_t)0x10000> operations;
+		for (int opcode = 0; opcode < 0x10000; opcode++)
+		{
+			operations[opcode] = Classify((U16)opcode);
+		}
+		return operations;
+	}
+
+	static int Substitute(const char* text, U16 opcode, U16 next, char* buffer, int size)
+	{
+		static const char digits[] = "0123456789ABCDEF";
+		int length = 0;
+		for (const char* c = text; *c && length < size - 1; c++)
+		{
+			if (*c != '%')
+			{
+				buffer[length++] = *c;
+			}
+			else if (c[1] == 'x' || c[1] == 'y')
+			{
+				buffer[length++] = digits[(opcode >> (c[1] == 'x' ? 8 : 4)) & 0xF];
+				++c;
+			}
+			else
+			{
+				int count = 0;
+				while (c[1] == 'n')
+				{
+					++count;
+					++c;
+				}
+				U16 value = count == 4 ? next : (U16)(opcode & ((1 << (count * 4)) - 1));
+				for (int digit = count - 1; digit >= 0 && length < size - 1; digit--)
+				{
+					buffer[length++] = digits[(value >> (digit * 4)) & 0xF];
+				}
+			}
+		}
+		buffer[length] = '\0';
+		return length;
+	}
+
+	int Disassemble(U16 opcode, U16 next, char* buffer, int size)
+	{
+		//unknown opcodes are data, the whole word is the value
+		int row = Find(opcode);
+		return row < 0 ? Substitute(UNKNOWN_PATTERN.m_Format, opcode, opcode, buffer, size) : Substitute(PATTERNS[row].m_Format, opcode, next, buffer, size);
+	}
+
+	int Describe(U16 opcode, char* buffer, int size)
+	{
+		int row = Find(opcode);
+		return Substitute(row < 0 ? UNKNOWN_PATTERN.m_Description : PATTERNS[row].m_Description, opcode, opcode, buffer, size);
+	}
+
+	string Disassemble(U16 opcode, U16 next)
+	{
+		char buffer[32];
+		int length = Disassemble(opcode, next, buffer, sizeof(buffer));
+		return string(buffer, length);
+	}
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <string>
+#include <array>
+
+using namespace std;
+
+typedef unsigned char  U8;
+typedef unsigned short U16;
+
+//the one description of every instruction, used by the interpreter, the predecoded engine, the logger and the tools.
+//an opcode is an instruction when opcode & mask == match, anything that matches no row is unknown and stops the game.
+//formats and descriptions take their operands from the opcode: %x and %y are the register digits,
+//a run of n after the % is the low bits of the opcode in that many hex digits (%nnnn is the word after F000)
+namespace Opcodes
+{
+	enum Operation : U8
+	{
+		CLS, RET, SCD, SCU, SCR, SCL, EXIT, LOW, HIGH,
+		JP, CALL, SE_VB, SNE_VB, SE_VV, SAVE_RANGE, LOAD_RANGE, LD_VB, ADD_VB,
+		LD_VV, OR, AND, XOR, ADD_VV, SUB, SHR, SUBN, SHL, SNE_VV,
+		LD_I, JP_V0, RND, DRW, SKP, SKNP,
+		LD_I_LONG, PLANE, AUDIO, LD_VDT, LD_KEY, LD_DT, LD_ST, ADD_I, LD_F, LD_HF, PITCH, BCD, STORE, LOAD, SAVE_FLAGS, LOAD_FLAGS,
+		UNKNOWN,
+		OPERATION_COUNT
+	};
+
+	struct Pattern
+	{
+		U16 m_Mask;
+		U16 m_Match;
+		Operation m_Operation;
+		const char* m_Format;
+		const char* m_Description;
+	};
+
+	//ordered on the first hex digit, so an opcode only has to be held against the rows of its own digit
+	constexpr Pattern PATTERNS[] =
+	{
+		{ 0xFFFF, 0x00E0, CLS, "CLS", "Clears the screen" },
+		{ 0xFFFF, 0x00EE, RET, "RET", "Returns from a subroutine" },
+		{ 0xFFF0, 0x00C0, SCD, "SCD %n", "Scrolls the screen down %n rows" },
+		{ 0xFFF0, 0x00D0, SCU, "SCU %n", "Scrolls the screen up %n rows" },
+		{ 0xFFFF, 0x00FB, SCR, "SCR", "Scrolls the screen right 4 pixels" },
+		{ 0xFFFF, 0x00FC, SCL, "SCL", "Scrolls the screen left 4 pixels" },
+		{ 0xFFFF, 0x00FD, EXIT, "EXIT", "Exits the interpreter" },
+		{ 0xFFFF, 0x00FE, LOW, "LOW", "Switches to 64x32 and clears the screen" },
+		{ 0xFFFF, 0x00FF, HIGH, "HIGH", "Switches to 128x64 and clears the screen" },
+		{ 0xFFFF, 0x0230, CLS, "CLS", "Clears the hires screen" },
+		{ 0xF000, 0x1000, JP, "JP %nnn", "Jumps to address %nnn" },
+		{ 0xF000, 0x2000, CALL, "CALL %nnn", "Calls subroutine at %nnn" },
+		{ 0xF000, 0x3000, SE_VB, "SE V%x, %nn", "Skips the next instruction if V%x equals %nn" },
+		{ 0xF000, 0x4000, SNE_VB, "SNE V%x, %nn", "Skips the next instruction if V%x doesn't equal %nn" },
+		{ 0xF00F, 0x5000, SE_VV, "SE V%x, V%y", "Skips the next instruction if V%x equals V%y" },
+		{ 0xF00F, 0x5002, SAVE_RANGE, "SAVE V%x - V%y", "Stores V%x to V%y in memory starting at address I" },
+		{ 0xF00F, 0x5003, LOAD_RANGE, "LOAD V%x - V%y", "Fills V%x to V%y from memory starting at address I" },
+		{ 0xF000, 0x6000, LD_VB, "LD V%x, %nn", "Sets V%x to %nn" },
+		{ 0xF000, 0x7000, ADD_VB, "ADD V%x, %nn", "Adds %nn to V%x" },
+		{ 0xF00F, 0x8000, LD_VV, "LD V%x, V%y", "Sets V%x to the value of V%y" },
+		{ 0xF00F, 0x8001, OR, "OR V%x, V%y", "Sets V%x to V%x or V%y" },
+		{ 0xF00F, 0x8002, AND, "AND V%x, V%y", "Sets V%x to V%x and V%y" },
+		{ 0xF00F, 0x8003, XOR, "XOR V%x, V%y", "Sets V%x to V%x xor V%y" },
+		{ 0xF00F, 0x8004, ADD_VV, "ADD V%x, V%y", "Adds V%y to V%x, VF is set to 1 when there's a carry" },
+		{ 0xF00F, 0x8005, SUB, "SUB V%x, V%y", "V%y is subtracted from V%x, VF is set to 0 when there's a borrow" },
+		{ 0xF00F, 0x8006, SHR, "SHR V%x", "Shifts V%x right by one, VF gets the bit shifted out" },
+		{ 0xF00F, 0x8007, SUBN, "SUBN V%x, V%y", "Sets V%x to V%y minus V%x, VF is set to 0 when there's a borrow" },
+		{ 0xF00F, 0x800E, SHL, "SHL V%x", "Shifts V%x left by one, VF gets the bit shifted out" },
+		{ 0xF000, 0x9000, SNE_VV, "SNE V%x, V%y", "Skips the next instruction if V%x doesn't equal V%y" },
+		{ 0xF000, 0xA000, LD_I, "LD I, %nnn", "Sets I to the address %nnn" },
+		{ 0xF000, 0xB000, JP_V0, "JP V0, %nnn", "Jumps to the address %nnn plus V0" },
+		{ 0xF000, 0xC000, RND, "RND V%x, %nn", "Sets V%x to a random number and %nn" },
+		{ 0xF000, 0xD000, DRW, "DRW V%x, V%y, %n", "Draws %n rows of the sprite at I at V%x, V%y" },
+		{ 0xF0FF, 0xE09E, SKP, "SKP V%x", "Skips the next instruction if the key in V%x is pressed" },
+		{ 0xF0FF, 0xE0A1, SKNP, "SKNP V%x", "Skips the next instruction if the key in V%x isn't pressed" },
+		{ 0xFFFF, 0xF000, LD_I_LONG, "LD I, %nnnn", "Sets I to the 16 bit address that follows" },
+		{ 0xF0FF, 0xF001, PLANE, "PLANE %x", "Selects planes %x for drawing" },
+		{ 0xFFFF, 0xF002, AUDIO, "AUDIO", "Loads the audio pattern from I" },
+		{ 0xF0FF, 0xF007, LD_VDT, "LD V%x, DT", "Sets V%x to the value of the delay timer" },
+		{ 0xF0FF, 0xF00A, LD_KEY, "LD V%x, K", "Waits for a key press and stores it in V%x" },
+		{ 0xF0FF, 0xF015, LD_DT, "LD DT, V%x", "Sets the delay timer to V%x" },
+		{ 0xF0FF, 0xF018, LD_ST, "LD ST, V%x", "Sets the sound timer to V%x" },
+		{ 0xF0FF, 0xF01E, ADD_I, "ADD I, V%x", "Adds V%x to I" },
+		{ 0xF0FF, 0xF029, LD_F, "LD F, V%x", "Sets I to the font sprite of the digit in V%x" },
+		{ 0xF0FF, 0xF030, LD_HF, "LD HF, V%x", "Sets I to the big font sprite of the digit in V%x" },
+		{ 0xF0FF, 0xF033, BCD, "LD B, V%x", "Stores the decimal digits of V%x at I, I+1 and I+2" },
+		{ 0xF0FF, 0xF03A, PITCH, "PITCH V%x", "Sets the audio pitch to V%x" },
+		{ 0xF0FF, 0xF055, STORE, "LD [I], V%x", "Stores V0 to V%x in memory starting at address I" },
+		{ 0xF0FF, 0xF065, LOAD, "LD V%x, [I]", "Fills V0 to V%x with values from memory starting at address I" },
+		{ 0xF0FF, 0xF075, SAVE_FLAGS, "LD R, V%x", "Stores V0 to V%x in the flag registers" },
+		{ 0xF0FF, 0xF085, LOAD_FLAGS, "LD V%x, R", "Fills V0 to V%x from the flag registers" },
+	};
+	constexpr int PATTERN_COUNT = (int)(sizeof(PATTERNS) / sizeof(PATTERNS[0]));
+	constexpr Pattern UNKNOWN_PATTERN = { 0x0000, 0x0000, UNKNOWN, "DW %nnnn", "Unknown opcode" };
+
+	//single return statements all the way down, the form of constexpr visual studio 2015 understands
+	constexpr int GroupStart(int digit, int i = 0)
+	{
+		return i == PATTERN_COUNT || (PATTERNS[i].m_Match >> 12) >= digit ? i : GroupStart(digit, i + 1);
+	}
+	constexpr int GROUPS[17] =
+	{
+		GroupStart(0x0), GroupStart(0x1), GroupStart(0x2), GroupStart(0x3), GroupStart(0x4), GroupStart(0x5), GroupStart(0x6), GroupStart(0x7),
+		GroupStart(0x8), GroupStart(0x9), GroupStart(0xA), GroupStart(0xB), GroupStart(0xC), GroupStart(0xD), GroupStart(0xE), GroupStart(0xF),
+		PATTERN_COUNT
+	};
+	constexpr int FindFrom(U16 opcode, int i, int end)
+	{
+		return i == end ? -1 : (opcode & PATTERNS[i].m_Mask) == PATTERNS[i].m_Match ? i : FindFrom(opcode, i + 1, end);
+	}
+	//the row of an opcode, -1 when it is unknown
+	constexpr int Find(U16 opcode)
+	{
+		return FindFrom(opcode, GROUPS[opcode >> 12], GROUPS[(opcode >> 12) + 1]);
+	}
+	constexpr Operation Classify(U16 opcode)
+	{
+		return Find(opcode) < 0 ? UNKNOWN : PATTERNS[Find(opcode)].m_Operation;
+	}
+	constexpr bool Ordered(int i = 1)
+	{
+		return i >= PATTERN_COUNT || ((PATTERNS[i - 1].m_Match >> 12) <= (PATTERNS[i].m_Match >> 12) && Ordered(i + 1));
+	}
+
+	static_assert(Ordered(), "opcode patterns have to be ordered on their first digit");
+	static_assert(Classify(0x00E0) == CLS && Classify(0x0230) == CLS && Classify(0x00C5) == SCD, "0 group");
+	static_assert(Classify(0x5AB2) == SAVE_RANGE && Classify(0x5AB1) == UNKNOWN, "5 group");
+	static_assert(Classify(0x812E) == SHL && Classify(0x8128) == UNKNOWN && Classify(0x9AB7) == SNE_VV, "8 and 9 group");
+	static_assert(Classify(0xF000) == LD_I_LONG && Classify(0xF100) == UNKNOWN && Classify(0xF301) == PLANE, "F group");
+
+	//every opcode value classified from the patterns, a 64k table is past what visual studio 2015 can build as constexpr
+	array<U8, (size_t)0x10000> MakeOperations();
+	//built on the first call instead of before main, static initializers of other files may classify opcodes too
+	inline const array<U8, (size_t)0x10000>& Operations()
+	{
+		static const array<U8, (size_t)0x10000> operations = MakeOperations();
+		return operations;
+	}
+	inline Operation Lookup(U16 opcode) { return (Operation)Operations()[opcode]; }
+
+	//the opcode as an assembler line, next is the word after it for F000 NNNN.
+	//both write into buffer, never more than size bytes with the terminating 0, and return the length
+	int Disassemble(U16 opcode, U16 next, char* buffer, int size);
+	//what the opcode does, in words
+	int Describe(U16 opcode, char* buffer, int size);
+	string Disassemble(U16 opcode, U16 next = 0);
+}
@@ -0,0 +1,430 @@
+#include "Renderer.h"
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+// Shader sources
+static const GLchar* vertexSource =
+"#version 150 core\n"
+"in vec2 position;"
+"in vec2 texcoord;"
+"in vec3 inColor;"
+"out vec3 InColor;"
+"out vec2 Texcoord;"
+"void main() {"
+"   InColor = inColor;"
+"   Texcoord = texcoord;"
+"   gl_Position = vec4(position, 0.0, 1.0);"
+"}";
+
+static const GLchar* fragmentSource =
+"#version 150 core\n"
+"in vec2 Texcoord;"
+"in vec3 InColor;"
+"out vec4 outColor;"
+"uniform sampler2D tex;"
+"void main() {"
+"   outColor = texture(tex, Texcoord) * vec4(InColor,1.0f);"
+"}";
+
+//keeps a pixel lit for a while after the game erased it, so xor redraws stop flickering
+static const GLchar* persistenceSource =
+"#version 150 core\n"
+"in vec2 Texcoord;"
+"in vec3 InColor;"
+"out vec4 outColor;"
+"uniform sampler2D tex;"
+"uniform sampler2D history;"
+"uniform float decay;"
+"void main() {"
+"   vec4 last = texture(history, vec2(Texcoord.x, 1.0 - Texcoord.y)) * decay;"
+"   outColor = max(texture(tex, Texcoord) * vec4(InColor,1.0f), last);"
+"}";
+
+const char* Renderer::PROGRAM_CACHE = "shader.bin";
+
+bool Renderer::Initialize()
+{
+	if (m_Program != 0)
+	{
+		return true;
+	}
+
+	////////////Make the triangle
+
+	//every time you call vertexattributepointer the information will be put in the vao
+	glGenVertexArrays(1, &m_Vao);
+	glBindVertexArray(m_Vao);
+
+	//vertice list
+	float vertices[] = {
+		//2d pos		//uv coords		//color
+		 1.0f, -1.0f,	1.0f,1.0f,		1.0f,1.0f,1.0f,//C
+		 1.0f,  1.0f,	1.0f,0.0f,		1.0f,1.0f,1.0f,//B
+		-1.0f, -1.0f,	0.0f,1.0f,		1.0f,1.0f,1.0f,//D
+
+		-1.0f, -1.0f,	0.0f,1.0f,		1.0f,1.0f,1.0f,//D
+		-1.0f,  1.0f,	0.0f,0.0f,		1.0f,1.0f,1.0f,//A
+		 1.0f,  1.0f,	1.0f,0.0f,		1.0f,1.0f,1.0f //B
+
+	};
+
+	//get the vertex buffer
+	glGenBuffers(1, &m_Vbo); // Generate 1 buffer
+
+	//to upload data to your vertex bufffer on the grafics card you have o set it active
+	//set vbo the active vertex buffer
+	glBindBuffer(GL_ARRAY_BUFFER, m_Vbo);
+
+	//copy your vertex data to the buffer
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+	//a cached binary skips compiling and linking the shaders altogether
+	if (!LoadProgramBinary() && !BuildProgram())
+	{
+		Shutdown();
+		return false;
+	}
+	//start using the shader programm
+	glUseProgram(m_Program);
+
+	//link the vertex data to the shader
+	GLint posAttrib = glGetAttribLocation(m_Program, "position");
+	// specify how the data for that input is retrieved from the array
+	glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(float), 0);
+	glEnableVertexAttribArray(posAttrib);
+
+	//link the vertex data to the shader
+	GLint UvAttrib = glGetAttribLocation(m_Program, "texcoord");
+	// specify how the data for that input is retrieved from the array
+	glVertexAttribPointer(UvAttrib, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(2 * sizeof(float)));
+	glEnableVertexAttribArray(UvAttrib);
+
+	//link the vertex data to the shader
+	GLint ColorAttrib = glGetAttribLocation(m_Program, "inColor");
+	// specify how the data for that input is retrieved from the array
+	glVertexAttribPointer(ColorAttrib, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(4 * sizeof(float)));
+	glEnableVertexAttribArray(ColorAttrib);
+
+	//textures
+	glGenTextures(1, &m_Texture);
+	glBindTexture(GL_TEXTURE_2D, m_Texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	m_TextureWidth = 0;
+	m_TextureHeight = 0;
+
+	//persistence asked for before the context was there
+	if (m_Decay > 0.0f)
+	{
+		SetPersistence(m_Decay);
+	}
+
+	return true;
+}
+
+bool Renderer::BuildProgram()
+{
+	/////////////compile the vertex shader
+
+	//make a shader object and load the shader in it
+	//see the top for the shader
+	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &vertexSource, NULL);
+
+	//compile the shader
+	glCompileShader(vertexShader);
+
+	GLint status;
+	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		glDeleteShader(vertexShader);
+		return false;
+	}
+	/////////////same for the fragment shader
+	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+	glCompileShader(fragmentShader);
+
+	//combine the two shaders into a program
+	m_Program = glCreateProgram();
+	glAttachShader(m_Program, vertexShader);
+	glAttachShader(m_Program, fragmentShader);
+
+	//specify which fragment shader output is written to which buffer
+	glBindFragDataLocation(m_Program, 0, "outColor");
+
+#ifdef GL_ARB_get_program_binary
+	if (GLAD_GL_ARB_get_program_binary)
+	{
+		//ask the driver to keep the binary around so it can be cached
+		glProgramParameteri(m_Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+#endif
+
+	//link the shader programm
+	glLinkProgram(m_Program);
+
+	//the linked program keeps what it needs, the shader objects can go
+	glDetachShader(m_Program, vertexShader);
+	glDetachShader(m_Program, fragmentShader);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	glGetProgramiv(m_Program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		return false;
+	}
+	SaveProgramBinary();
+	return true;
+}
+
+bool Renderer::LoadProgramBinary()
+{
+#ifdef GL_ARB_get_program_binary
+	if (!GLAD_GL_ARB_get_program_binary)
+	{
+		return false;
+	}
+
+	//the file is the binary format followed by the binary itself
+	ifstream file(PROGRAM_CACHE, ifstream::in | ifstream::binary);
+	GLenum format = 0;
+	if (!file.read((char*)&format, sizeof(format)))
+	{
+		return false;
+	}
+	vector<char> binary((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	if (binary.empty())
+	{
+		return false;
+	}
+
+	m_Program = glCreateProgram();
+	glProgramBinary(m_Program, format, binary.data(), (GLsizei)binary.size());
+
+	//a driver update makes old binaries invalid, then the shaders are built again
+	GLint status;
+	glGetProgramiv(m_Program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		glDeleteProgram(m_Program);
+		m_Program = 0;
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Renderer::SaveProgramBinary()
+{
+#ifdef GL_ARB_get_program_binary
+	if (!GLAD_GL_ARB_get_program_binary)
+	{
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(m_Program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+	vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(m_Program, length, NULL, &format, binary.data());
+
+	ofstream file(PROGRAM_CACHE, ofstream::out | ofstream::binary);
+	file.write((const char*)&format, sizeof(format));
+	file.write(binary.data(), binary.size());
+#endif
+}
+
+bool Renderer::BuildPersistenceProgram()
+{
+	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &vertexSource, NULL);
+	glCompileShader(vertexShader);
+	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShader, 1, &persistenceSource, NULL);
+	glCompileShader(fragmentShader);
+
+	m_PersistenceProgram = glCreateProgram();
+	glAttachShader(m_PersistenceProgram, vertexShader);
+	glAttachShader(m_PersistenceProgram, fragmentShader);
+	glBindFragDataLocation(m_PersistenceProgram, 0, "outColor");
+
+	//both programs read the same vao, so the inputs have to sit where the main program has them
+	glBindAttribLocation(m_PersistenceProgram, glGetAttribLocation(m_Program, "position"), "position");
+	glBindAttribLocation(m_PersistenceProgram, glGetAttribLocation(m_Program, "texcoord"), "texcoord");
+	glBindAttribLocation(m_PersistenceProgram, glGetAttribLocation(m_Program, "inColor"), "inColor");
+	glLinkProgram(m_PersistenceProgram);
+
+	glDetachShader(m_PersistenceProgram, vertexShader);
+	glDetachShader(m_PersistenceProgram, fragmentShader);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint status;
+	glGetProgramiv(m_PersistenceProgram, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		glDeleteProgram(m_PersistenceProgram);
+		m_PersistenceProgram = 0;
+		return false;
+	}
+	glUseProgram(m_PersistenceProgram);
+	glUniform1i(glGetUniformLocation(m_PersistenceProgram, "tex"), 0);
+	glUniform1i(glGetUniformLocation(m_PersistenceProgram, "history"), 1);
+	glUseProgram(m_Program);
+	return true;
+}
+
+void Renderer::SetPersistence(float decay)
+{
+	m_Decay = max(0.0f, min(decay, 0.99f));
+	if (m_Decay > 0.0f && m_PersistenceProgram == 0 && m_Program != 0 && !BuildPersistenceProgram())
+	{
+		m_Decay = 0.0f;
+		return;
+	}
+	if (m_PersistenceProgram != 0)
+	{
+		glUseProgram(m_PersistenceProgram);
+		glUniform1f(glGetUniformLocation(m_PersistenceProgram, "decay"), m_Decay);
+		glUseProgram(m_Program);
+	}
+}
+
+void Renderer::ResizeHistory()
+{
+	if (m_History[0] == 0)
+	{
+		glGenTextures(2, m_History);
+		glGenFramebuffers(2, m_HistoryFbo);
+	}
+
+	//starts out black, nothing has been lit yet
+	vector<U8> black(m_TextureWidth * m_TextureHeight * 3, 0);
+	for (int i = 0; i < 2; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_History[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, m_TextureWidth, m_TextureHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, black.data());
+		glBindFramebuffer(GL_FRAMEBUFFER, m_HistoryFbo[i]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_History[i], 0);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, m_Texture);
+	m_HistoryWidth = m_TextureWidth;
+	m_HistoryHeight = m_TextureHeight;
+}
+
+void Renderer::Shutdown()
+{
+	if (m_History[0] != 0)
+	{
+		glDeleteFramebuffers(2, m_HistoryFbo);
+		glDeleteTextures(2, m_History);
+	}
+	if (m_PersistenceProgram != 0)
+	{
+		glDeleteProgram(m_PersistenceProgram);
+	}
+	m_History[0] = m_History[1] = m_HistoryFbo[0] = m_HistoryFbo[1] = m_PersistenceProgram = 0;
+	m_HistoryWidth = m_HistoryHeight = 0;
+	if (m_Texture != 0)
+	{
+		glDeleteTextures(1, &m_Texture);
+	}
+	if (m_Program != 0)
+	{
+		glDeleteProgram(m_Program);
+	}
+	if (m_Vbo != 0)
+	{
+		glDeleteBuffers(1, &m_Vbo);
+	}
+	if (m_Vao != 0)
+	{
+		glDeleteVertexArrays(1, &m_Vao);
+	}
+	m_Texture = m_Program = m_Vbo = m_Vao = 0;
+}
+
+void Renderer::Upload(const Chip8& machine)
+{
+	if (!machine.m_GameLoaded)
+	{
+		return;
+	}
+
+	//off, first plane, second plane and both planes
+	static const U8 palette[4] = { 0, 255, 170, 85 };
+
+	int width = machine.ScreenWidth();
+	int height = machine.ScreenHeight();
+	U8 pixels[128 * 64];
+	U8 pixelbuffer[128 * 64 * 3];
+	machine.Unpack(pixels);
+	for (int i = 0; i < width * height; i++)
+	{
+		U8 j = palette[pixels[i]];
+		pixelbuffer[(i * 3) + 0] = j;
+		pixelbuffer[(i * 3) + 1] = j;
+		pixelbuffer[(i * 3) + 2] = j;
+	}
+
+	//storage only has to be made again when the game switches between screen modes
+	if (width != m_TextureWidth || height != m_TextureHeight)
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixelbuffer);
+		m_TextureWidth = width;
+		m_TextureHeight = height;
+	}
+	else
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixelbuffer);
+	}
+}
+
+void Renderer::Present()
+{
+	if (m_Decay <= 0.0f || m_PersistenceProgram == 0 || m_TextureWidth == 0)
+	{
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+		return;
+	}
+
+	if (m_HistoryWidth != m_TextureWidth || m_HistoryHeight != m_TextureHeight)
+	{
+		ResizeHistory();
+	}
+
+	//combine the new screen with the last frame at chip8 resolution, everything stays on the gpu
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_HistoryFbo[m_Current]);
+	glViewport(0, 0, m_TextureWidth, m_TextureHeight);
+	glUseProgram(m_PersistenceProgram);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_History[1 - m_Current]);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_Texture);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+
+	//and scale the result into the window
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_HistoryFbo[m_Current]);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, m_TextureWidth, m_TextureHeight,
+		viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3], GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glUseProgram(m_Program);
+	m_Current = 1 - m_Current;
+}
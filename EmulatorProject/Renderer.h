@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <glad/glad.h>
+#include "Chip8.h"
+
+using namespace std;
+
+//owns the opengl objects that put the chip8 screen in the window,
+//they are made once and reused for every game that gets loaded
+class Renderer
+{
+public:
+	Renderer() {};
+	~Renderer() { Shutdown(); }
+
+	//builds the quad, shader program and texture, does nothing when they already exist
+	bool Initialize();
+	//deletes every gl object, has to run while the context is still alive
+	void Shutdown();
+
+	//copies the screen of the machine into the texture
+	void Upload(const Chip8& machine);
+	//draws the textured quad
+	void Present();
+
+	//how much of the previous frame stays lit, 0 turns the phosphor pass off
+	void SetPersistence(float decay);
+	float GetPersistence() const { return m_Decay; }
+
+private:
+	//where the linked program binary is kept between runs
+	static const char* PROGRAM_CACHE;
+
+	bool LoadProgramBinary();
+	void SaveProgramBinary();
+	bool BuildProgram();
+	bool BuildPersistenceProgram();
+	void ResizeHistory();
+
+	GLuint m_Vao = 0;
+	GLuint m_Vbo = 0;
+	GLuint m_Program = 0;
+	GLuint m_Texture = 0;
+	int m_TextureWidth = 0;
+	int m_TextureHeight = 0;
+
+	//phosphor pass: the screen is combined with the decayed last frame into one of two
+	//history textures at chip8 resolution, which is then scaled up into the window
+	float m_Decay = 0.0f;
+	GLuint m_PersistenceProgram = 0;
+	GLuint m_History[2] = { 0, 0 };
+	GLuint m_HistoryFbo[2] = { 0, 0 };
+	int m_HistoryWidth = 0;
+	int m_HistoryHeight = 0;
+	int m_Current = 0;
+};
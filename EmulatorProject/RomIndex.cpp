@@ -0,0 +1,284 @@
+#include "RomIndex.h"
+#include <experimental/filesystem>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::experimental::filesystem;
+
+//the index lives in the library folder itself
+static const char* INDEX_FILE = "chip8.index";
+static const char INDEX_MAGIC[4] = { 'C', '8', 'I', 'X' };
+
+static bool IsRomFile(const fs::path& path)
+{
+	string extension = path.extension().string();
+	transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return extension == ".ch8" || extension == ".c8" || extension == ".sc8" || extension == ".xo8" || extension == ".hc8";
+}
+
+RomIndex::RomIndex(const string& folder) : m_Folder(folder)
+{
+	//paths in the index are relative, so the folder never ends in a separator
+	while (!m_Folder.empty() && (m_Folder.back() == '/' || m_Folder.back() == '\\'))
+	{
+		m_Folder.pop_back();
+	}
+}
+
+U64 RomIndex::HashBytes(const vector<U8>& data)
+{
+	//FNV-1a, plenty for telling roms apart
+	U64 hash = 14695981039346656037ULL;
+	for (U8 byte : data)
+	{
+		hash ^= byte;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+void RomIndex::Analyse(const vector<U8>& rom, RomEntry& entry)
+{
+	entry.m_Size = rom.size();
+	entry.m_Hash = HashBytes(rom);
+	entry.m_Variant = 0;
+	entry.m_Quirks = 0;
+
+	if (rom.size() >= 2 && rom[0] == 0x12 && rom[1] == 0x60)
+	{
+		entry.m_Variant |= VARIANT_HIRES;
+	}
+
+	//code and data are mixed, so this only looks for opcodes that are unlikely to show up by accident
+	for (size_t i = 0; i + 1 < rom.size(); i += 2)
+	{
+		U16 opcode = rom[i] << 8 | rom[i + 1];
+		if ((opcode & 0xFFF0) == 0x00C0 || (opcode >= 0x00FB && opcode <= 0x00FF) ||
+			(opcode & 0xF0FF) == 0xF030 || (opcode & 0xF0FF) == 0xF075 || (opcode & 0xF0FF) == 0xF085)
+		{
+			entry.m_Variant |= VARIANT_SCHIP;
+		}
+		if (opcode == 0xF000 || opcode == 0xF002 || (opcode & 0xF00F) == 0x5002 || (opcode & 0xF00F) == 0x5003 ||
+			(opcode & 0xF0FF) == 0xF001 || (opcode & 0xFFF0) == 0x00D0)
+		{
+			entry.m_Variant |= VARIANT_XOCHIP;
+		}
+	}
+
+	//xo-chip went back to the original behaviour, super-chip roms expect all of its changes
+	if ((entry.m_Variant & VARIANT_SCHIP) && !(entry.m_Variant & VARIANT_XOCHIP))
+	{
+		entry.m_Quirks = QUIRK_SHIFT | QUIRK_LOADSTORE | QUIRK_JUMP | QUIRK_CLIP;
+	}
+
+	//run the rom without input for a while and keep what is on the screen
+	entry.m_Thumbnail.fill(0);
+	Chip8 machine(nullptr);
+	machine.m_Muted = true;
+	if (!machine.LoadRom(rom.data(), rom.size()))
+	{
+		return;
+	}
+	int executed = 0;
+	machine.RunFor(THUMBNAIL_FRAMES * INSTRUCTIONS_PER_FRAME, executed);
+	//super-chip screens are twice as wide, every other column is kept
+	int step = machine.ScreenWidth() / 64;
+	for (int y = 0; y < machine.ScreenHeight(); y++)
+	{
+		for (int x = 0; x < 64; x++)
+		{
+			if (machine.Pixel(x * step, y))
+			{
+				int i = y * 64 + x;
+				entry.m_Thumbnail[i / 8] |= 0x80 >> (i % 8);
+			}
+		}
+	}
+}
+
+void RomIndex::Refresh()
+{
+	//what the last index knew, by path
+	unordered_map<string, size_t> known;
+	for (size_t i = 0; i < m_Entries.size(); i++)
+	{
+		known[m_Entries[i].m_Path] = i;
+	}
+
+	vector<fs::path> files;
+	error_code error;
+	for (fs::recursive_directory_iterator it(m_Folder, error), end; !error && it != end; it.increment(error))
+	{
+		if (fs::is_regular_file(it->status()) && IsRomFile(it->path()))
+		{
+			files.push_back(it->path());
+		}
+	}
+
+	vector<RomEntry> entries(files.size());
+	vector<U8> valid(files.size(), 0); //a byte per file, the workers write them at the same time
+	atomic<size_t> next(0);
+	auto worker = [&]()
+	{
+		size_t i;
+		while ((i = next++) < files.size())
+		{
+			RomEntry& entry = entries[i];
+			string full = files[i].string();
+			entry.m_Path = full.substr(min(full.size(), m_Folder.size() + 1));
+			error_code fileError;
+			entry.m_ModifiedTime = fs::last_write_time(files[i], fileError).time_since_epoch().count();
+			U64 size = fs::file_size(files[i], fileError);
+			if (fileError)
+			{
+				continue;
+			}
+
+			//unchanged size and time, nothing has to be read
+			unordered_map<string, size_t>::const_iterator old = known.find(entry.m_Path);
+			if (old != known.end() && m_Entries[old->second].m_Size == size &&
+				m_Entries[old->second].m_ModifiedTime == entry.m_ModifiedTime)
+			{
+				entry = m_Entries[old->second];
+				valid[i] = 1;
+				continue;
+			}
+
+			ifstream file(full, ifstream::in | ifstream::binary);
+			if (!file.good())
+			{
+				continue;
+			}
+			vector<U8> rom((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+			//touched but not changed, only the time is new
+			if (old != known.end() && m_Entries[old->second].m_Hash == HashBytes(rom))
+			{
+				long long modified = entry.m_ModifiedTime;
+				entry = m_Entries[old->second];
+				entry.m_ModifiedTime = modified;
+			}
+			else
+			{
+				Analyse(rom, entry);
+			}
+			valid[i] = 1;
+		}
+	};
+
+	int threadcount = max(1, (int)thread::hardware_concurrency());
+	vector<thread> workers;
+	for (int t = 0; t < threadcount; t++)
+	{
+		workers.push_back(thread(worker));
+	}
+	for (thread& w : workers)
+	{
+		w.join();
+	}
+
+	//files that disappeared or could not be read drop out of the index
+	m_Entries.clear();
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (valid[i])
+		{
+			m_Entries.push_back(move(entries[i]));
+		}
+	}
+	sort(m_Entries.begin(), m_Entries.end(), [](const RomEntry& a, const RomEntry& b) { return a.m_Path < b.m_Path; });
+}
+
+bool RomIndex::Load()
+{
+	ifstream file(m_Folder + "/" + INDEX_FILE, ifstream::in | ifstream::binary);
+	char magic[4];
+	U16 version = 0;
+	U32 count = 0;
+	if (!file.read(magic, 4) || !equal(magic, magic + 4, INDEX_MAGIC) ||
+		!file.read((char*)&version, sizeof(version)) || version != VERSION ||
+		!file.read((char*)&count, sizeof(count)))
+	{
+		return false;
+	}
+
+	//a truncated or damaged file can claim any count, there can be no more entries than the rest of the file holds
+	streamoff start = file.tellg();
+	file.seekg(0, ifstream::end);
+	streamoff left = file.tellg() - start;
+	file.seekg(start);
+	const streamoff smallest = sizeof(U16) + sizeof(U64) + sizeof(long long) + sizeof(U64) + 2 + sizeof(RomEntry().m_Thumbnail);
+	if (count > left / smallest)
+	{
+		return false;
+	}
+
+	vector<RomEntry> entries;
+	entries.reserve(count);
+	for (U32 i = 0; i < count; i++)
+	{
+		RomEntry entry;
+		U16 length = 0;
+		if (!file.read((char*)&length, sizeof(length)))
+		{
+			return false;
+		}
+		entry.m_Path.resize(length);
+		if (!file.read(&entry.m_Path[0], length) ||
+			!file.read((char*)&entry.m_Size, sizeof(entry.m_Size)) ||
+			!file.read((char*)&entry.m_ModifiedTime, sizeof(entry.m_ModifiedTime)) ||
+			!file.read((char*)&entry.m_Hash, sizeof(entry.m_Hash)) ||
+			!file.read((char*)&entry.m_Variant, sizeof(entry.m_Variant)) ||
+			!file.read((char*)&entry.m_Quirks, sizeof(entry.m_Quirks)) ||
+			!file.read((char*)entry.m_Thumbnail.data(), entry.m_Thumbnail.size()))
+		{
+			return false;
+		}
+		entries.push_back(move(entry));
+	}
+	m_Entries = move(entries);
+	return true;
+}
+
+bool RomIndex::Save() const
+{
+	ofstream file(m_Folder + "/" + INDEX_FILE, ofstream::out | ofstream::binary);
+	U16 version = VERSION;
+	U32 count = (U32)m_Entries.size();
+	file.write(INDEX_MAGIC, 4);
+	file.write((const char*)&version, sizeof(version));
+	file.write((const char*)&count, sizeof(count));
+	for (const RomEntry& entry : m_Entries)
+	{
+		U16 length = (U16)entry.m_Path.size();
+		file.write((const char*)&length, sizeof(length));
+		file.write(entry.m_Path.data(), length);
+		file.write((const char*)&entry.m_Size, sizeof(entry.m_Size));
+		file.write((const char*)&entry.m_ModifiedTime, sizeof(entry.m_ModifiedTime));
+		file.write((const char*)&entry.m_Hash, sizeof(entry.m_Hash));
+		file.write((const char*)&entry.m_Variant, sizeof(entry.m_Variant));
+		file.write((const char*)&entry.m_Quirks, sizeof(entry.m_Quirks));
+		file.write((const char*)entry.m_Thumbnail.data(), entry.m_Thumbnail.size());
+	}
+	return file.good();
+}
+
+string RomIndex::Find(const string& text) const
+{
+	string needle = text;
+	transform(needle.begin(), needle.end(), needle.begin(), ::tolower);
+	for (const RomEntry& entry : m_Entries)
+	{
+		string path = entry.m_Path;
+		transform(path.begin(), path.end(), path.begin(), ::tolower);
+		if (path.find(needle) != string::npos)
+		{
+			return m_Folder + "/" + entry.m_Path;
+		}
+	}
+	return string();
+}
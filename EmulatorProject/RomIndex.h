@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include "Chip8.h"
+
+using namespace std;
+
+//what a rom looks like it was written for, more than one can be set
+enum RomVariant : U8
+{
+	VARIANT_HIRES = 1 << 0,		//64x64 hack, starts with 1260
+	VARIANT_SCHIP = 1 << 1,		//uses super-chip opcodes (scrolling, 00FE/00FF, FX30, FX75/FX85)
+	VARIANT_XOCHIP = 1 << 2		//uses xo-chip opcodes (F000 NNNN, 5XY2/5XY3, FN01, F002)
+};
+
+//interpreter behaviour the rom most likely expects
+enum RomQuirk : U8
+{
+	QUIRK_SHIFT = 1 << 0,		//8XY6/8XYE shift VX in place and ignore VY
+	QUIRK_LOADSTORE = 1 << 1,	//FX55/FX65 leave I untouched
+	QUIRK_JUMP = 1 << 2,		//BXNN jumps to XNN plus VX
+	QUIRK_CLIP = 1 << 3			//sprites are clipped at the screen edge instead of wrapping
+};
+
+struct RomEntry
+{
+	string m_Path; //relative to the library folder
+	U64 m_Size;
+	long long m_ModifiedTime;
+	U64 m_Hash;
+	U8 m_Variant;
+	U8 m_Quirks;
+	array<U8, 64 * 64 / 8> m_Thumbnail; //the 64x64 screen after THUMBNAIL_FRAMES, one bit per pixel
+};
+
+//keeps the metadata of every rom in a folder tree in one small file,
+//so picking a rom does not mean reading thousands of files again
+class RomIndex
+{
+public:
+	static const int THUMBNAIL_FRAMES = 120;
+	static const int INSTRUCTIONS_PER_FRAME = 10;
+
+	RomIndex(const string& folder);
+
+	//reads the index file, false when there is none, it is from another version or it is damaged.
+	//the entries are left alone then, so Refresh builds the index again
+	bool Load();
+	bool Save() const;
+	//scans the folder on all cores and analyses only files that are new or changed since the last index
+	void Refresh();
+
+	//the first rom whose path contains the text, empty when there is none
+	string Find(const string& text) const;
+	const vector<RomEntry>& GetEntries() const { return m_Entries; }
+
+	static U64 HashBytes(const vector<U8>& data);
+	static void Analyse(const vector<U8>& rom, RomEntry& entry);
+
+private:
+	static const U16 VERSION = 2;
+
+	string m_Folder;
+	vector<RomEntry> m_Entries;
+};
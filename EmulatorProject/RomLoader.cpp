@@ -0,0 +1,67 @@
+#include "RomLoader.h"
+#include "Logger.h"
+
+RomLoader::RomLoader(GLFWwindow* window) : m_Window(window)
+{
+	m_Thread = thread(&RomLoader::Work, this);
+}
+
+RomLoader::~RomLoader()
+{
+	{
+		lock_guard<mutex> lock(m_Lock);
+		m_Stop = true;
+	}
+	m_Wake.notify_one();
+	m_Thread.join();
+}
+
+void RomLoader::Request(const string& path)
+{
+	{
+		lock_guard<mutex> lock(m_Lock);
+		m_Requested = path;
+		m_HasRequest = true;
+	}
+	m_Wake.notify_one();
+}
+
+unique_ptr<Chip8> RomLoader::TakeLoaded()
+{
+	lock_guard<mutex> lock(m_Lock);
+	return move(m_Loaded);
+}
+
+void RomLoader::Work()
+{
+	unique_lock<mutex> lock(m_Lock);
+	while (true)
+	{
+		m_Wake.wait(lock, [this] { return m_Stop || m_HasRequest; });
+		if (m_Stop)
+		{
+			return;
+		}
+		string path = m_Requested;
+		m_HasRequest = false;
+
+		//reading and checking the file happens without the lock, the render thread only waits for the hand over
+		lock.unlock();
+		unique_ptr<Chip8> machine(new Chip8(m_Window));
+		bool loaded = machine->LoadGame(path);
+		if (loaded)
+		{
+			Logger::Log("Loaded file " + path);
+		}
+		else
+		{
+			Logger::Log("Could not load " + path + ", the running game keeps going", 0x0C);
+		}
+		lock.lock();
+
+		if (loaded)
+		{
+			m_Loaded = move(machine);
+		}
+	}
+}
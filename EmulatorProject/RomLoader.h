@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Chip8.h"
+
+using namespace std;
+
+//loads roms on a worker thread into a fresh machine, so the window keeps drawing while files are read
+class RomLoader
+{
+public:
+	RomLoader(GLFWwindow* window);
+	~RomLoader();
+
+	//queues a rom, a newer request replaces one that has not started yet
+	void Request(const string& path);
+	//the machine of the last finished load, empty when nothing new is ready, call it between frames
+	unique_ptr<Chip8> TakeLoaded();
+
+private:
+	void Work();
+
+	GLFWwindow* m_Window;
+	thread m_Thread;
+	mutex m_Lock;
+	condition_variable m_Wake;
+	string m_Requested;
+	bool m_HasRequest = false;
+	bool m_Stop = false;
+	unique_ptr<Chip8> m_Loaded;
+};
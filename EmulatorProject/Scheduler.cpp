@@ -0,0 +1,166 @@
+#include "Scheduler.h"
+#include "Metrics.h"
+#include <algorithm>
+
+Scheduler::Scheduler(int threads, int budget) : m_Budget(budget)
+{
+	int threadcount = threads > 0 ? threads : max(1, (int)thread::hardware_concurrency());
+	for (int t = 0; t < threadcount; t++)
+	{
+		m_Queues.push_back(unique_ptr<Queue>(new Queue()));
+	}
+	for (int t = 0; t < threadcount; t++)
+	{
+		m_Workers.push_back(thread(&Scheduler::Work, this, (size_t)t));
+	}
+}
+
+Scheduler::~Scheduler()
+{
+	{
+		lock_guard<mutex> lock(m_Lock);
+		m_Quitting = true;
+	}
+	m_Started.notify_all();
+	for (thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+size_t Scheduler::Tick(vector<ScheduledMachine*>& machines, chrono::steady_clock::time_point deadline, const function<void(size_t)>& after)
+{
+	++m_Tick;
+
+	//a parked machine costs nothing until its keys change
+	vector<size_t> order;
+	order.reserve(machines.size());
+	for (size_t i = 0; i < machines.size(); i++)
+	{
+		ScheduledMachine& scheduled = *machines[i];
+		if (scheduled.m_Parked)
+		{
+			if (!scheduled.m_Running || scheduled.m_Machine->m_Keys == scheduled.m_ParkedKeys)
+			{
+				++scheduled.m_ParkedTicks;
+				continue;
+			}
+			scheduled.m_Parked = false;
+		}
+		order.push_back(i);
+	}
+
+	//the ones that waited longest go to the front of every queue
+	stable_sort(order.begin(), order.end(), [&machines](size_t a, size_t b)
+	{
+		return machines[a]->m_LastTick < machines[b]->m_LastTick;
+	});
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		m_Queues[i % m_Queues.size()]->m_Items.push_back(order[i]);
+	}
+
+	{
+		lock_guard<mutex> lock(m_Lock);
+		m_Machines = &machines;
+		m_After = &after;
+		m_Deadline = deadline;
+		m_Ran = 0;
+		m_Busy = (int)m_Workers.size();
+		++m_Generation;
+	}
+	m_Started.notify_all();
+	{
+		unique_lock<mutex> lock(m_Lock);
+		m_Finished.wait(lock, [this]() { return m_Busy == 0; });
+	}
+
+	//whatever the deadline left over is late, it runs first next tick
+	for (unique_ptr<Queue>& queue : m_Queues)
+	{
+		for (size_t item : queue->m_Items)
+		{
+			++machines[item]->m_LateTicks;
+		}
+		queue->m_Items.clear();
+	}
+	return m_Ran;
+}
+
+void Scheduler::Work(size_t worker)
+{
+	U32 seen = 0;
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(m_Lock);
+			m_Started.wait(lock, [&]() { return m_Quitting || m_Generation != seen; });
+			if (m_Quitting)
+			{
+				return;
+			}
+			seen = m_Generation;
+		}
+
+		size_t ran = 0;
+		size_t item;
+		while (Take(worker, item))
+		{
+			Run(*(*m_Machines)[item]);
+			(*m_After)(item);
+			++ran;
+		}
+
+		lock_guard<mutex> lock(m_Lock);
+		m_Ran += ran;
+		if (--m_Busy == 0)
+		{
+			m_Finished.notify_one();
+		}
+	}
+}
+
+bool Scheduler::Take(size_t worker, size_t& item)
+{
+	if (chrono::steady_clock::now() >= m_Deadline)
+	{
+		return false;
+	}
+
+	//its own queue first, then the others. thieves take from the front as well, the back holds the machines
+	//that ran most recently and taking those would let the same ones win every tick a deadline cuts short
+	for (size_t i = 0; i < m_Queues.size(); i++)
+	{
+		Queue& queue = *m_Queues[(worker + i) % m_Queues.size()];
+		lock_guard<mutex> lock(queue.m_Lock);
+		if (!queue.m_Items.empty())
+		{
+			item = queue.m_Items.front();
+			queue.m_Items.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void Scheduler::Run(ScheduledMachine& scheduled)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	Chip8& machine = *scheduled.m_Machine;
+	int executed = 0;
+	ExitReason reason = scheduled.m_Running ? machine.RunFor(m_Budget, executed) : EXIT_STOPPED;
+	scheduled.m_Running = !Stops(reason);
+
+	//FX0A without a key and without running timers comes back to itself, every instruction after it would too
+	bool waiting = reason == EXIT_WAITING_FOR_KEY && machine.m_DelayTimer == 0 && machine.m_SoundTimer == 0;
+	if (!scheduled.m_Running || waiting)
+	{
+		scheduled.m_Parked = true;
+		scheduled.m_ParkedKeys = machine.m_Keys;
+	}
+
+	scheduled.m_Instructions += executed;
+	scheduled.m_CpuSeconds += Metrics::Seconds(start, chrono::steady_clock::now());
+	++scheduled.m_Ticks;
+	scheduled.m_LastTick = m_Tick;
+}
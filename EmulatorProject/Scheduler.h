@@ -0,0 +1,77 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include "Chip8.h"
+
+using namespace std;
+
+//a machine as the scheduler sees it, kept by whoever owns the machine
+struct ScheduledMachine
+{
+	Chip8* m_Machine = nullptr;
+	bool m_Running = true; //false once the game stopped, it stays parked then
+	//waiting on FX0A with no key held and both timers at 0, nothing changes until the keys do
+	bool m_Parked = false;
+	U16 m_ParkedKeys = 0;
+	U32 m_LastTick = 0; //the tick it last ran in, machines the deadline cut off go first in the next one
+
+	//accounting since it was added
+	U64 m_Instructions = 0;
+	double m_CpuSeconds = 0.0; //time the workers spent running it
+	U32 m_Ticks = 0; //ticks it ran in
+	U32 m_ParkedTicks = 0;
+	U32 m_LateTicks = 0; //ticks it did not get to before the deadline
+};
+
+//runs many machines on a fixed set of worker threads, one 60 hz tick at a time.
+//every machine gets the same instruction budget per tick, so a busy rom can not take time from the others.
+//each worker has its own queue and takes from the others when it runs dry, a tick that goes past its deadline
+//leaves the rest for the next tick instead of making every session late
+class Scheduler
+{
+public:
+	//threads 0 means one per core
+	Scheduler(int threads, int budget);
+	~Scheduler();
+
+	//runs every machine that is not parked, after is called on the worker with the index of every machine that ran.
+	//returns the amount of machines that ran
+	size_t Tick(vector<ScheduledMachine*>& machines, chrono::steady_clock::time_point deadline, const function<void(size_t)>& after);
+
+	int GetBudget() const { return m_Budget; }
+
+private:
+	struct Queue
+	{
+		mutex m_Lock;
+		deque<size_t> m_Items;
+	};
+
+	void Work(size_t worker);
+	bool Take(size_t worker, size_t& item);
+	void Run(ScheduledMachine& scheduled);
+
+	int m_Budget;
+	vector<unique_ptr<Queue>> m_Queues;
+	vector<thread> m_Workers;
+
+	//what the current tick works on, only changed while the workers wait
+	vector<ScheduledMachine*>* m_Machines = nullptr;
+	const function<void(size_t)>* m_After = nullptr;
+	chrono::steady_clock::time_point m_Deadline;
+	U32 m_Tick = 0;
+
+	mutex m_Lock;
+	condition_variable m_Started;
+	condition_variable m_Finished;
+	U32 m_Generation = 0;
+	int m_Busy = 0;
+	size_t m_Ran = 0;
+	bool m_Quitting = false;
+};
@@ -0,0 +1,350 @@
+#include "UnixSocket.h"
+#include "SessionServer.h"
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+
+SessionServer::~SessionServer()
+{
+	for (size_t i = 0; i < m_Clients.size(); i++)
+	{
+		Disconnect(i);
+	}
+	if (m_Listener != ~0ULL)
+	{
+		closesocket((SOCKET)m_Listener);
+	}
+}
+
+bool SessionServer::Listen(const string& path)
+{
+	if (!StartWinsock() || path.size() >= sizeof(UnixAddress::sun_path))
+	{
+		return false;
+	}
+	SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (s == INVALID_SOCKET)
+	{
+		return false;
+	}
+
+	//a socket file left behind by an earlier run would make bind fail
+	DeleteFileA(path.c_str());
+	UnixAddress address = {};
+	address.sun_family = AF_UNIX;
+	strncpy_s(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+	unsigned long nonblocking = 1;
+	if (bind(s, (sockaddr*)&address, sizeof(address)) != 0 || listen(s, 16) != 0 || ioctlsocket(s, FIONBIO, &nonblocking) != 0)
+	{
+		closesocket(s);
+		return false;
+	}
+	m_Listener = s;
+	return true;
+}
+
+bool SessionServer::Run()
+{
+	if (m_Listener == ~0ULL)
+	{
+		return false;
+	}
+
+	chrono::steady_clock::time_point next = chrono::steady_clock::now();
+	while (true)
+	{
+		SOCKET client;
+		while ((client = accept((SOCKET)m_Listener, NULL, NULL)) != INVALID_SOCKET)
+		{
+			unsigned long nonblocking = 1;
+			ioctlsocket(client, FIONBIO, &nonblocking);
+			//the slot of a client that went away is taken again, sessions only keep the index
+			auto free = find_if(m_Clients.begin(), m_Clients.end(), [](const Client& c) { return c.m_Socket == ~0ULL; });
+			if (free == m_Clients.end())
+			{
+				m_Clients.push_back(Client());
+				free = m_Clients.end() - 1;
+			}
+			free->m_Socket = client;
+		}
+		if (WSAGetLastError() != WSAEWOULDBLOCK)
+		{
+			Logger::Log("The session socket failed", 0x0C);
+			return false;
+		}
+		for (size_t i = 0; i < m_Clients.size(); i++)
+		{
+			Receive(i);
+		}
+
+		//a client that does not read its frames only gets them again once it caught up
+		vector<ScheduledMachine*> machines;
+		for (unique_ptr<Session>& session : m_Sessions)
+		{
+			session->m_Backlogged = m_Clients[session->m_Client].m_Pending.size() > MAX_BACKLOG;
+			session->m_Message.clear();
+			machines.push_back(&session->m_Schedule);
+		}
+		//a quarter of the tick stays for reading and writing the sockets
+		m_Scheduler.Tick(machines, chrono::steady_clock::now() + chrono::microseconds(16667 * 3 / 4), [this](size_t i)
+		{
+			Publish(*m_Sessions[i]);
+		});
+
+		for (unique_ptr<Session>& session : m_Sessions)
+		{
+			m_Clients[session->m_Client].m_Pending.append(session->m_Message.begin(), session->m_Message.end());
+		}
+		for (size_t i = 0; i < m_Clients.size(); i++)
+		{
+			Flush(i);
+		}
+
+		//a tick that took too long is not made up for, the next one starts right away
+		next += chrono::microseconds(16667);
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if (next < now)
+		{
+			next = now;
+		}
+		this_thread::sleep_until(next);
+	}
+}
+
+void SessionServer::Publish(Session& session)
+{
+	++session.m_Frame;
+	if (session.m_Backlogged)
+	{
+		return;
+	}
+
+	//the screen words as bytes, highest byte first so the leftmost pixel is the top bit
+	array<U8, (size_t)FRAME_BYTES> screen;
+	const Chip8& machine = *session.m_Machine;
+	for (size_t word = 0; word < machine.m_ScreenBuffer.size(); word++)
+	{
+		for (int byte = 0; byte < 8; byte++)
+		{
+			screen[word * 8 + byte] = (U8)(machine.m_ScreenBuffer[word] >> (56 - byte * 8));
+		}
+	}
+	vector<U8> payload;
+	Encode(session.m_Sent.data(), screen.data(), FRAME_BYTES, payload);
+	session.m_Sent = screen;
+
+	std::stringstream header;
+	header << "frame " << session.m_Id << " " << session.m_Frame << " " << machine.ScreenWidth() << " " << machine.ScreenHeight()
+		<< " " << payload.size() << "\n";
+	string line = header.str();
+	session.m_Message.assign(line.begin(), line.end());
+	session.m_Message.insert(session.m_Message.end(), payload.begin(), payload.end());
+}
+
+void SessionServer::Encode(const U8* previous, const U8* current, size_t size, vector<U8>& out)
+{
+	auto put = [&out](size_t value)
+	{
+		out.push_back((U8)value);
+		out.push_back((U8)(value >> 8));
+	};
+	auto changed = [&](size_t i) { return (previous[i] ^ current[i]) != 0; };
+
+	size_t i = 0;
+	while (i < size)
+	{
+		size_t zeros = 0;
+		while (i + zeros < size && zeros < 0xFFFF && !changed(i + zeros))
+		{
+			++zeros;
+		}
+		i += zeros;
+
+		//a literal run goes on over short gaps, a pair header costs as much as four zero bytes
+		size_t start = i;
+		while (i < size && i - start < 0xFFFF - 4)
+		{
+			size_t gap = 0;
+			while (gap < 4 && i + gap < size && !changed(i + gap))
+			{
+				++gap;
+			}
+			if (gap == 4 || i + gap == size)
+			{
+				break;
+			}
+			i += gap + 1;
+		}
+
+		put(zeros);
+		put(i - start);
+		for (size_t j = start; j < i; j++)
+		{
+			out.push_back(previous[j] ^ current[j]);
+		}
+	}
+}
+
+bool SessionServer::Decode(const U8* data, size_t length, U8* screen, size_t size)
+{
+	size_t read = 0;
+	size_t i = 0;
+	while (read < length)
+	{
+		if (length - read < 4)
+		{
+			return false;
+		}
+		size_t zeros = data[read] | data[read + 1] << 8;
+		size_t literals = data[read + 2] | data[read + 3] << 8;
+		read += 4;
+		if (i + zeros + literals > size || read + literals > length)
+		{
+			return false;
+		}
+		i += zeros;
+		for (size_t j = 0; j < literals; j++)
+		{
+			screen[i++] ^= data[read++];
+		}
+	}
+	return i == size;
+}
+
+void SessionServer::Receive(size_t index)
+{
+	Client& client = m_Clients[index];
+	if (client.m_Socket == ~0ULL)
+	{
+		return;
+	}
+
+	char buffer[512];
+	int received;
+	while ((received = recv((SOCKET)client.m_Socket, buffer, sizeof(buffer), 0)) > 0)
+	{
+		client.m_Received.append(buffer, received);
+	}
+	if (received == 0 || (received == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK))
+	{
+		Disconnect(index);
+		return;
+	}
+
+	size_t end;
+	while ((end = client.m_Received.find('\n')) != string::npos)
+	{
+		string line = client.m_Received.substr(0, end);
+		client.m_Received.erase(0, end + 1);
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+		string reply = line.empty() ? "" : Execute(index, line);
+		if (!reply.empty())
+		{
+			client.m_Pending += reply + "\n";
+		}
+	}
+}
+
+string SessionServer::Execute(size_t client, const string& line)
+{
+	std::stringstream in(line);
+	string command;
+	in >> command;
+
+	if (command == "open")
+	{
+		string path;
+		getline(in >> ws, path);
+		unique_ptr<Session> session(new Session());
+		session->m_Id = m_NextId;
+		session->m_Client = client;
+		session->m_Machine.reset(new Chip8(nullptr));
+		session->m_Machine->m_Muted = true;
+		session->m_Sent.fill(0);
+		if (!session->m_Machine->LoadGame(path))
+		{
+			return "error could not load " + path;
+		}
+		session->m_Schedule.m_Machine = session->m_Machine.get();
+		m_Sessions.push_back(move(session));
+		return "session " + to_string(m_NextId++);
+	}
+
+	//the other commands name a session of this client
+	U32 id = 0;
+	in >> id;
+	auto found = find_if(m_Sessions.begin(), m_Sessions.end(), [&](const unique_ptr<Session>& session)
+	{
+		return session->m_Id == id && session->m_Client == client;
+	});
+	if (command != "keys" && command != "close" && command != "stats")
+	{
+		return "error unknown command " + command;
+	}
+	if (found == m_Sessions.end())
+	{
+		return "error no session " + to_string(id);
+	}
+	if (command == "keys")
+	{
+		string mask;
+		in >> mask;
+		(*found)->m_Machine->m_Keys = (U16)strtoul(mask.c_str(), nullptr, 16);
+		return "";
+	}
+	if (command == "stats")
+	{
+		const ScheduledMachine& scheduled = (*found)->m_Schedule;
+		std::stringstream stats;
+		stats << "stats " << id << " instructions " << scheduled.m_Instructions << " cpu_us " << (long long)(scheduled.m_CpuSeconds * 1000000.0)
+			<< " ticks " << scheduled.m_Ticks << " parked_ticks " << scheduled.m_ParkedTicks << " late_ticks " << scheduled.m_LateTicks
+			<< (scheduled.m_Parked ? (scheduled.m_Running ? " waiting" : " stopped") : " running");
+		return stats.str();
+	}
+	m_Sessions.erase(found);
+	return "closed " + to_string(id);
+}
+
+void SessionServer::Flush(size_t index)
+{
+	Client& client = m_Clients[index];
+	while (client.m_Socket != ~0ULL && !client.m_Pending.empty())
+	{
+		int sent = send((SOCKET)client.m_Socket, client.m_Pending.data(), (int)min(client.m_Pending.size(), (size_t)65536), 0);
+		if (sent > 0)
+		{
+			client.m_Pending.erase(0, sent);
+		}
+		else if (sent == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK)
+		{
+			return;
+		}
+		else
+		{
+			Disconnect(index);
+		}
+	}
+}
+
+void SessionServer::Disconnect(size_t index)
+{
+	Client& client = m_Clients[index];
+	if (client.m_Socket == ~0ULL)
+	{
+		return;
+	}
+	closesocket((SOCKET)client.m_Socket);
+	client.m_Socket = ~0ULL;
+	client.m_Received.clear();
+	client.m_Pending.clear();
+	m_Sessions.erase(remove_if(m_Sessions.begin(), m_Sessions.end(), [index](const unique_ptr<Session>& session)
+	{
+		return session->m_Client == index;
+	}), m_Sessions.end());
+}
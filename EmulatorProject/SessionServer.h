@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include "Chip8.h"
+#include "Scheduler.h"
+
+using namespace std;
+
+//hosts many machines in one process for clients on a unix socket, without a window.
+//clients send lines: "open <rom>" answers "session <id>", "keys <id> <hex mask>" sets the held keys,
+//"close <id>" answers "closed <id>", "stats <id>" answers with what the session cost so far.
+//every tick each session runs a frame on the scheduler and its client gets "frame <id> <number> <width> <height> <bytes>"
+//followed by that many bytes: the screen xor the screen sent before, run length encoded, see Encode.
+//a static screen is a 4 byte frame, a session parked on a key sends nothing until it wakes up
+class SessionServer
+{
+public:
+	//both planes, 64 rows of 16 bytes each, x 0 is the top bit of the first byte of a row, narrow modes use 8 bytes
+	static const int FRAME_BYTES = Chip8::PLANES * 64 * Chip8::ROW_WORDS * 8;
+
+	SessionServer(int threads, int instructionsPerFrame = 5) : m_Scheduler(threads, instructionsPerFrame) {}
+	~SessionServer();
+
+	bool Listen(const string& path);
+	//serves clients at 60 ticks per second, only returns when the listening socket fails
+	bool Run();
+
+	//pairs of a 16 bit zero count and a 16 bit literal count, little endian, each followed by its literal bytes.
+	//the zeros and literals are the two screens xored, they cover all size bytes
+	static void Encode(const U8* previous, const U8* current, size_t size, vector<U8>& out);
+	//applies an encoded frame to the screen before it, false when it is malformed. CodecCheck.cpp round trips both
+	static bool Decode(const U8* data, size_t length, U8* screen, size_t size);
+
+private:
+	static const size_t MAX_BACKLOG = 1 << 20; //frames are dropped for a client this far behind
+
+	struct Session
+	{
+		U32 m_Id;
+		size_t m_Client; //index into m_Clients
+		unique_ptr<Chip8> m_Machine;
+		ScheduledMachine m_Schedule;
+		bool m_Backlogged = false; //the frame of this tick is not sent, the next one is a delta against the last one sent
+		U32 m_Frame = 0;
+		array<U8, (size_t)FRAME_BYTES> m_Sent; //the screen as the client has it
+		vector<U8> m_Message; //what this tick sends
+	};
+
+	struct Client
+	{
+		unsigned long long m_Socket = ~0ULL; //SOCKET, kept opaque so winsock stays out of the header
+		string m_Received;
+		string m_Pending; //written as the socket takes it
+	};
+
+	void Receive(size_t client);
+	string Execute(size_t client, const string& line);
+	void Flush(size_t client);
+	void Disconnect(size_t client);
+	//the frame of a session that ran this tick, on a worker
+	void Publish(Session& session);
+
+	unsigned long long m_Listener = ~0ULL;
+	vector<Client> m_Clients; //a closed client leaves its slot with an invalid socket for the next one
+	vector<unique_ptr<Session>> m_Sessions;
+	U32 m_NextId = 1;
+	Scheduler m_Scheduler;
+};
@@ -0,0 +1,173 @@
+#include "SoftwareRenderer.h"
+#define GLFW_EXPOSE_NATIVE_WIN32
+#include <GLFW/glfw3native.h>
+#include <windows.h>
+#include <cstring>
+#include <algorithm>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTWARERENDERER_SSE2
+#endif
+
+//off, first plane, second plane and both planes, the same gray levels as the opengl renderer
+static const U8 PALETTE[4] = { 0, 255, 170, 85 };
+
+bool SoftwareRenderer::Initialize(GLFWwindow* window)
+{
+	Shutdown();
+	m_Window = glfwGetWin32Window(window);
+	m_DeviceContext = m_Window != nullptr ? GetDC((HWND)m_Window) : nullptr;
+	if (m_DeviceContext == nullptr)
+	{
+		m_Window = nullptr;
+		return false;
+	}
+	//64x64 is the tallest frame, width * width pixels
+	m_Pixels.assign((size_t)m_Width * m_Width, 0);
+	m_Target = m_Pixels.data();
+	return true;
+}
+
+bool SoftwareRenderer::Initialize(const string& surface)
+{
+	Shutdown();
+	DWORD size = (DWORD)(sizeof(SurfaceHeader) + (size_t)m_Width * m_Width * sizeof(U32));
+	m_Mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, size, surface.c_str());
+	if (m_Mapping == NULL)
+	{
+		m_Mapping = nullptr;
+		return false;
+	}
+	m_Surface = (SurfaceHeader*)MapViewOfFile(m_Mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (m_Surface == nullptr)
+	{
+		Shutdown();
+		return false;
+	}
+	memcpy(m_Surface->m_Magic, "C8FB", 4);
+	m_Surface->m_Width = 0;
+	m_Surface->m_Height = 0;
+	m_Surface->m_Sequence = 0;
+	m_Target = (U32*)(m_Surface + 1);
+	return true;
+}
+
+void SoftwareRenderer::Shutdown()
+{
+	if (m_DeviceContext != nullptr)
+	{
+		ReleaseDC((HWND)m_Window, (HDC)m_DeviceContext);
+	}
+	if (m_Surface != nullptr)
+	{
+		UnmapViewOfFile(m_Surface);
+	}
+	if (m_Mapping != nullptr)
+	{
+		CloseHandle(m_Mapping);
+	}
+	m_Window = m_DeviceContext = m_Mapping = nullptr;
+	m_Surface = nullptr;
+	m_Target = nullptr;
+	m_Pixels.clear();
+	m_FrameWidth = m_FrameHeight = 0;
+}
+
+void SoftwareRenderer::BuildTable(int scale)
+{
+	m_Table.resize(256 * 4 * scale);
+	for (int key = 0; key < 256; key++)
+	{
+		for (int pixel = 0; pixel < 4; pixel++)
+		{
+			//the leftmost pixel is the top bit of each half
+			U8 gray = PALETTE[((key >> (3 - pixel)) & 1) | (((key >> (7 - pixel)) & 1) << 1)];
+			U32 color = 0xFF000000u | gray << 16 | gray << 8 | gray;
+			fill_n(&m_Table[(key * 4 + pixel) * scale], scale, color);
+		}
+	}
+	m_Scale = scale;
+}
+
+void SoftwareRenderer::Upload(const Chip8& machine)
+{
+	if (!machine.m_GameLoaded || m_Target == nullptr)
+	{
+		return;
+	}
+
+	int width = machine.ScreenWidth();
+	int height = machine.ScreenHeight();
+	int scale = max(1, m_Width / width);
+	if (scale != m_Scale)
+	{
+		BuildTable(scale);
+	}
+	m_FrameWidth = width * scale;
+	m_FrameHeight = height * scale;
+
+	//readers leave the surface alone while the sequence is odd
+	if (m_Surface != nullptr && (m_Surface->m_Sequence & 1) == 0)
+	{
+		InterlockedIncrement(&m_Surface->m_Sequence);
+	}
+
+	for (int y = 0; y < height; y++)
+	{
+		U32* row = m_Target + (size_t)y * scale * m_FrameWidth;
+		U32* out = row;
+		for (int w = 0; w < width / 64; w++)
+		{
+			U64 first = machine.m_ScreenBuffer[y * Chip8::ROW_WORDS + w];
+			U64 second = machine.m_ScreenBuffer[(64 + y) * Chip8::ROW_WORDS + w];
+			for (int shift = 60; shift >= 0; shift -= 4)
+			{
+				const U32* run = &m_Table[(((first >> shift) & 0xF) | (((second >> shift) & 0xF) << 4)) * 4 * scale];
+#ifdef SOFTWARERENDERER_SSE2
+				//a run is scale blocks of four pixels
+				for (int block = 0; block < scale; block++)
+				{
+					_mm_storeu_si128((__m128i*)out + block, _mm_loadu_si128((const __m128i*)run + block));
+				}
+#else
+				memcpy(out, run, 4 * scale * sizeof(U32));
+#endif
+				out += 4 * scale;
+			}
+		}
+		//the other rows of a scaled pixel row are the same
+		for (int copy = 1; copy < scale; copy++)
+		{
+			memcpy(row + (size_t)copy * m_FrameWidth, row, m_FrameWidth * sizeof(U32));
+		}
+	}
+}
+
+void SoftwareRenderer::Present()
+{
+	if (m_FrameWidth == 0)
+	{
+		return;
+	}
+
+	if (m_Surface != nullptr)
+	{
+		m_Surface->m_Width = m_FrameWidth;
+		m_Surface->m_Height = m_FrameHeight;
+		if (m_Surface->m_Sequence & 1)
+		{
+			InterlockedIncrement(&m_Surface->m_Sequence);
+		}
+		return;
+	}
+
+	//top down 32 bit rows, the frame is exactly as big as the window
+	BITMAPINFO info = {};
+	info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	info.bmiHeader.biWidth = m_FrameWidth;
+	info.bmiHeader.biHeight = -m_FrameHeight;
+	info.bmiHeader.biPlanes = 1;
+	info.bmiHeader.biBitCount = 32;
+	info.bmiHeader.biCompression = BI_RGB;
+	SetDIBitsToDevice((HDC)m_DeviceContext, 0, 0, m_FrameWidth, m_FrameHeight, 0, 0, 0, m_FrameHeight, m_Target, &info, DIB_RGB_COLORS);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Chip8.h"
+
+using namespace std;
+
+//puts the chip8 screen in the window or in shared memory without opengl, for machines without a gpu.
+//the packed screen is expanded straight to 32 bit pixels at a whole scale factor: four pixels of both planes
+//form one byte that picks a ready made run of scaled pixels from a table, copied 16 bytes at a time
+class SoftwareRenderer
+{
+public:
+	//what a reader of the shared surface finds at the start of it, the pixels follow right after.
+	//the sequence is odd while a frame is being written and goes up by two for every frame
+	struct SurfaceHeader
+	{
+		char m_Magic[4]; //C8FB
+		U32 m_Width;
+		U32 m_Height;
+		volatile long m_Sequence;
+	};
+
+	//width is what the screen is scaled to, 64x32 and 128x64 both fill it, 64x64 is as high as it is wide
+	SoftwareRenderer(int width) : m_Width(width) {}
+	~SoftwareRenderer() { Shutdown(); }
+
+	//draws into the client area of the window, which has to be made without an opengl context
+	bool Initialize(GLFWwindow* window);
+	//draws into a named shared memory surface that other processes can map
+	bool Initialize(const string& surface);
+	void Shutdown();
+
+	//expands the screen of the machine into the frame
+	void Upload(const Chip8& machine);
+	//hands the frame to the window or the surface
+	void Present();
+
+	//the frame as the last Upload left it, in the surface when there is one
+	const U32* GetPixels() const { return m_Target; }
+	int GetFrameWidth() const { return m_FrameWidth; }
+	int GetFrameHeight() const { return m_FrameHeight; }
+
+private:
+	//one byte of the table index per four pixels: the first plane in the low bits, the second in the high bits
+	void BuildTable(int scale);
+
+	int m_Width;
+	int m_Scale = 0;
+	vector<U32> m_Table; //256 runs of 4 * m_Scale pixels
+	vector<U32> m_Pixels;
+	U32* m_Target = nullptr; //m_Pixels or the pixels of the surface
+	int m_FrameWidth = 0;
+	int m_FrameHeight = 0;
+
+	//gdi target
+	void* m_Window = nullptr;
+	void* m_DeviceContext = nullptr;
+
+	//shared memory target
+	void* m_Mapping = nullptr;
+	SurfaceHeader* m_Surface = nullptr;
+};
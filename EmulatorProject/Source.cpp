@@ -1,4 +1,6 @@
 #include <iostream>
+#include <sstream>
+#include <iomanip>
 
 // GLAD
 #include <glad/glad.h>
@@ -10,61 +12,247 @@
 #include "Chip8.h"
 
 #include "Logger.h"
-
-// Shader sources
-const GLchar* vertexSource =
-"#version 150 core\n"
-"in vec2 position;"
-"in vec2 texcoord;"
-"in vec3 inColor;"
-"out vec3 InColor;"
-"out vec2 Texcoord;"
-"void main() {"
-"   InColor = inColor;"
-"   Texcoord = texcoord;"
-"   gl_Position = vec4(position, 0.0, 1.0);"
-"}";
-
-const GLchar* fragmentSource =
-"#version 150 core\n"
-"in vec2 Texcoord;"
-"in vec3 InColor;"
-"out vec4 outColor;"
-"uniform sampler2D tex;"
-"void main() {"
-"   outColor = texture(tex, Texcoord) * vec4(InColor,1.0f);"
-"}";
-
+#include "Explorer.h"
+#include "Metrics.h"
+#include "LatencyProbe.h"
+#include "SpeedController.h"
+#include "Renderer.h"
+#include "SoftwareRenderer.h"
+#include "RomLoader.h"
+#include "RomIndex.h"
+#include "Headless.h"
+#include "MonitorView.h"
+#include "Debugger.h"
+#include "Verifier.h"
+#include "SessionServer.h"
 
 // Function prototypes
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
+void OnDragAndDrop(GLFWwindow *wndw, int i, const char **path);
+void SetTitle(GLFWwindow *wndw, const string& path);
+int RunWall(GLFWwindow* window, int count, const vector<string>& roms, Metrics& metrics);
+int RunBenchmark(GLFWwindow* window, Renderer& renderer, int frames, const string& gamepath);
+int RunSoftwareBenchmark(GLFWwindow* window, SoftwareRenderer& renderer, int frames, const string& gamepath, const string& target);
 
 // Window dimensions
 const GLuint WIDTH = 1024, HEIGHT = 512;
-bool Initialize(GLFWwindow *wndw);
 
 Chip8* m_Emulator;
+SpeedController m_Speed;
+RomLoader* m_Loader;
 
 
 // The MAIN function, from here we start the application and run the game loop
 int main(int argc, char* argv[])
 {
-	for (size_t i = 0; i < argc; i++)
+	string gamepath;
+	//where -batch and -replay record their frames to, nothing is recorded without it
+	string capturetarget;
+	int capturescale = 4;
+	//frames emulated ahead of the presented one to hide the games input lag
+	int runahead = 0;
+	Metrics metrics;
+	LatencyProbe latency;
+	metrics.SetLatency(&latency);
+	bool metricstitle = false;
+	//instances shown side by side in one window, with the roms they cycle through
+	int wallcount = 0;
+	vector<string> wallroms;
+	float persistence = 0.0f;
+	int benchmarkframes = 0;
+	//the screen is expanded on the cpu and drawn with gdi, or put in a shared memory surface when it has a name
+	bool software = false;
+	string surfacename;
+	//instructions between two state comparisons of -verify
+	int verifyinterval = 1000;
+	//folder of decoded roms kept between -batch runs, -batch runs on the predecoded engine when it is set
+	string codecache;
+	Debugger debugger;
+	for (int i = 0; i < argc; i++)
 	{
 		cout << argv[i] << endl;
+		if (string(argv[i]) == "-explore")
+		{
+			//headless coverage run over every rom after the flag, no window needed
+			Explorer explorer;
+			bool explored = true;
+			for (int j = i + 1; j < argc; j++)
+			{
+				explored = explorer.Run(argv[j]) && explored;
+			}
+			return explored ? 0 : 1;
+		}
+		else if (string(argv[i]) == "-batch" && i + 1 < argc)
+		{
+			//headless run of every rom or archive after the frame count, prints where each one ends up
+			HeadlessRunner runner(atoi(argv[i + 1]));
+			runner.SetCapture(capturetarget, capturetarget.empty() ? "" : ".y4m", capturescale);
+			runner.SetCodeCache(codecache);
+			vector<string> roms(argv + i + 2, argv + argc);
+			return runner.Run(roms) ? 0 : 1;
+		}
+		else if (string(argv[i]) == "-replay" && i + 2 < argc)
+		{
+			//plays back the input sequences the explorer found for a rom, recorded when -capture came first
+			HeadlessRunner runner(0);
+			runner.SetCapture(capturetarget, "", capturescale);
+			return runner.Replay(argv[i + 1], argv[i + 2]) ? 0 : 1;
+		}
+		else if (string(argv[i]) == "-verify" && i + 1 < argc)
+		{
+			//runs every rom or archive after the frame count on the predecoded engine and the interpreter side by side
+			Verifier verifier(atoi(argv[i + 1]), verifyinterval);
+			vector<string> roms(argv + i + 2, argv + argc);
+			return verifier.Run(roms) ? 0 : 1;
+		}
+		else if (string(argv[i]) == "-serve" && i + 2 < argc)
+		{
+			//hosts sessions for clients on the unix socket at this path, on a pool of this many threads, 0 for one per core
+			SessionServer server(atoi(argv[i + 2]));
+			if (!server.Listen(argv[i + 1]))
+			{
+				Logger::Log(string("Could not listen for sessions on ") + argv[i + 1], 0x0C);
+				return 1;
+			}
+			return server.Run() ? 0 : 1;
+		}
+		else if (string(argv[i]) == "-verify-interval" && i + 1 < argc)
+		{
+			verifyinterval = atoi(argv[++i]);
+		}
+		else if (string(argv[i]) == "-code-cache" && i + 1 < argc)
+		{
+			codecache = argv[++i];
+		}
+		else if (string(argv[i]) == "-capture" && i + 2 < argc)
+		{
+			//a folder of .y4m files for -batch, a .y4m or animated .png file for -replay
+			capturetarget = argv[++i];
+			capturescale = atoi(argv[++i]);
+		}
+		else if (string(argv[i]) == "-wall" && i + 1 < argc)
+		{
+			//every rom or archive after the instance count, handed out to the instances in turn
+			wallcount = max(1, atoi(argv[i + 1]));
+			wallroms = HeadlessRunner::Expand(vector<string>(argv + i + 2, argv + argc));
+			break;
+		}
+		else if (string(argv[i]) == "-index" && i + 1 < argc)
+		{
+			//bring the index of a rom library up to date and list it
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			RomIndex index(argv[++i]);
+			index.Load();
+			index.Refresh();
+			bool saved = index.Save();
+			for (const RomEntry& entry : index.GetEntries())
+			{
+				std::stringstream stream;
+				stream << std::hex << entry.m_Hash << " " << std::dec << entry.m_Size << " bytes"
+					<< ((entry.m_Variant & VARIANT_HIRES) ? " hires" : "")
+					<< ((entry.m_Variant & VARIANT_SCHIP) ? " schip" : "")
+					<< ((entry.m_Variant & VARIANT_XOCHIP) ? " xochip" : "") << " " << entry.m_Path;
+				Logger::Log(stream.str());
+			}
+			std::stringstream stream;
+			stream << std::dec << index.GetEntries().size() << " roms indexed in " << (int)(Metrics::Seconds(start, chrono::steady_clock::now()) * 1000.0) << " ms";
+			Logger::Log(stream.str());
+			return saved ? 0 : 1;
+		}
+		else if (string(argv[i]) == "-library" && i + 2 < argc)
+		{
+			//pick a rom by name from the library index, only scanning when there is no index yet
+			RomIndex index(argv[++i]);
+			if (!index.Load())
+			{
+				index.Refresh();
+				index.Save();
+			}
+			gamepath = index.Find(argv[++i]);
+			if (gamepath.empty())
+			{
+				Logger::Log(string("No rom matches ") + argv[i], 0x0C);
+			}
+		}
+		else if (string(argv[i]) == "-runahead" && i + 1 < argc)
+		{
+			runahead = atoi(argv[++i]);
+		}
+		else if (string(argv[i]) == "-rate" && i + 1 < argc)
+		{
+			//emulated instructions per second the speed controller aims for
+			m_Speed.SetTarget(atof(argv[++i]));
+		}
+		else if (string(argv[i]) == "-turbo" && i + 1 < argc)
+		{
+			m_Speed.SetTurbo(atoi(argv[++i]));
+		}
+		else if (string(argv[i]) == "-metrics" && i + 1 < argc)
+		{
+			if (!metrics.Open(argv[++i]))
+			{
+				Logger::Log(string("Could not open metrics output ") + argv[i], 0x0C);
+			}
+		}
+		else if (string(argv[i]) == "-metrics-interval" && i + 1 < argc)
+		{
+			metrics.SetInterval(atof(argv[++i]));
+		}
+		else if (string(argv[i]) == "-persistence" && i + 1 < argc)
+		{
+			//phosphor decay per frame, 0.8 keeps an erased pixel visible for a few frames
+			persistence = (float)atof(argv[++i]);
+		}
+		else if (string(argv[i]) == "-debug" && i + 1 < argc)
+		{
+			//lets a debugging tool attach on this unix socket path
+			if (!debugger.Listen(argv[++i]))
+			{
+				Logger::Log(string("Could not listen for a debugger on ") + argv[i], 0x0C);
+			}
+		}
+		else if (string(argv[i]) == "-benchmark" && i + 1 < argc)
+		{
+			benchmarkframes = atoi(argv[++i]);
+		}
+		else if (string(argv[i]) == "-present" && i + 1 < argc)
+		{
+			//gl or gdi
+			software = string(argv[++i]) == "gdi";
+		}
+		else if (string(argv[i]) == "-surface" && i + 1 < argc)
+		{
+			software = true;
+			surfacename = argv[++i];
+		}
+		else if (string(argv[i]) == "-metrics-title")
+		{
+			metricstitle = true;
+		}
+		else if (i > 0)
+		{
+			gamepath = argv[i];
+		}
 	}
-	std::cout << "Starting GLFW context, OpenGL 3.3" << std::endl;
+	std::cout << (software ? "Starting GLFW without a context" : "Starting GLFW context, OpenGL 3.3") << std::endl;
 	// Init GLFW
 	glfwInit();
 	// Set all the required options for GLFW
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	if (software)
+	{
+		//gdi can not draw into a window opengl owns
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+	}
+	else
+	{
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	}
 	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
 
 	// Create a GLFWwindow object that we can use for GLFW's functions
 	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "", NULL, NULL);
-	glfwMakeContextCurrent(window);
 	if (window == NULL)
 	{
 		std::cout << "Failed to create GLFW window" << std::endl;
@@ -75,203 +263,377 @@ int main(int argc, char* argv[])
 	// Set the required callback functions
 	glfwSetKeyCallback(window, key_callback);
 
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	if (!software)
 	{
-		std::cout << "Failed to initialize OpenGL context" << std::endl;
-		return -1;
-	}
+		glfwMakeContextCurrent(window);
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << "Failed to initialize OpenGL context" << std::endl;
+			return -1;
+		}
+
+		//turbo is only limited by the host, waiting on vsync would cap it again
+		glfwSwapInterval(m_Speed.IsTurbo() ? 0 : 1);
 
-	// Define the viewport dimensions
-	glViewport(0, 0, WIDTH, HEIGHT);
+		// Define the viewport dimensions
+		glViewport(0, 0, WIDTH, HEIGHT);
+	}
 
 	m_Emulator = new Chip8(window);
+	RomLoader loader(window);
+	m_Loader = &loader;
 	Logger::getInstance()->SetWindow(window);
+	if (metricstitle)
+	{
+		metrics.SetTitleOverlay(window);
+	}
+
+	if (wallcount > 0 && software)
+	{
+		Logger::Log("The wall needs opengl", 0x0C);
+		glfwTerminate();
+		return 1;
+	}
+	if (wallcount > 0)
+	{
+		int result = RunWall(window, wallcount, wallroms, metrics);
+		glfwTerminate();
+		return result;
+	}
 
 	GLFWimage* t;
-	int gamespeed = 5;
-	bool lasthiresmode = true;
-	if (Initialize(window))
+	bool lastsquare = true;
+	Renderer renderer;
+	SoftwareRenderer softwarerenderer(WIDTH);
+	//the phosphor pass only exists in the opengl renderer
+	renderer.SetPersistence(persistence);
+	bool initialized = software ? (surfacename.empty() ? softwarerenderer.Initialize(window) : softwarerenderer.Initialize(surfacename)) : renderer.Initialize();
+	if (!initialized)
 	{
+		Logger::Log(surfacename.empty() ? "Could not set up the renderer" : "Could not make the shared surface " + surfacename, 0x0C);
+	}
+	if (benchmarkframes > 0)
+	{
+		int result = !initialized ? 1 : software ? RunSoftwareBenchmark(window, softwarerenderer, benchmarkframes, gamepath, surfacename.empty() ? "gdi" : surfacename)
+			: RunBenchmark(window, renderer, benchmarkframes, gamepath);
+		renderer.Shutdown();
+		glfwTerminate();
+		return result;
+	}
+	if (initialized)
+	{
+		glfwSetDropCallback(window, OnDragAndDrop);
 		m_Emulator->LoadGame("Chip-8_Pack/Chip-8 Demos/Maze (alt) [David Winter, 199x].ch8");
-		if (argc > 1)
+		if (!gamepath.empty())
 		{
-			m_Emulator->LoadGame(argv[1]);
+			m_Emulator->LoadGame(gamepath);
 		}
 		bool t = true;
+
+		Chip8State snapshot;
+		auto uploadscreen = [&]()
+		{
+			software ? softwarerenderer.Upload(*m_Emulator) : renderer.Upload(*m_Emulator);
+		};
 		// Game loop
 		while (!glfwWindowShouldClose(window) && t)
 		{
 			// Check if any events have been activated (key pressed, mouse moved etc.) and call corresponding response functions
 			glfwPollEvents();
 
-			if (glfwGetKey(window, GLFW_KEY_UP))
+			//a rom that finished loading in the background takes over between two frames
+			unique_ptr<Chip8> loaded = loader.TakeLoaded();
+			if (loaded)
 			{
-				++gamespeed;
+				delete m_Emulator;
+				m_Emulator = loaded.release();
+				SetTitle(window, m_Emulator->m_Path);
+				t = true;
 			}
-			if (glfwGetKey(window, GLFW_KEY_DOWN))
+
+			//64x64 gets a square window, 64x32 and 128x64 share the wide one
+			bool square = m_Emulator->ScreenWidth() == m_Emulator->ScreenHeight();
+			if (lastsquare != square)
 			{
-				--gamespeed;
-				if (gamespeed <= 1)
+				lastsquare = square;
+				glfwSetWindowSize(window, WIDTH, square ? WIDTH : HEIGHT);
+				if (!software)
 				{
-					gamespeed = 1;
+					glViewport(0, 0, WIDTH, square ? WIDTH : HEIGHT);
 				}
 			}
-			
-			if (lasthiresmode != m_Emulator->hiresmode)
+
+			m_Emulator->PollKeys();
+			latency.SampleKeys(*m_Emulator);
+			debugger.Poll(*m_Emulator);
+			int owed = m_Speed.BeginFrame();
+			int executed = 0;
+			if (m_Speed.IsTurbo())
 			{
-				lasthiresmode = m_Emulator->hiresmode;
-				if (m_Emulator->hiresmode)
+				//uncapped, keep emulating in small batches until the frames time is used up
+				while (t && m_Speed.HasTime() && !debugger.IsPaused())
 				{
-					glfwSetWindowSize(window, WIDTH, WIDTH);
-					glViewport(0, 0, WIDTH, WIDTH);
-				}
-				else
-				{
-					glfwSetWindowSize(window, WIDTH, HEIGHT);
-					glViewport(0, 0, WIDTH, HEIGHT);
-
+					executed += debugger.Run(*m_Emulator, 1000, t);
 				}
 			}
+			else
+			{
+				executed = debugger.Run(*m_Emulator, owed, t);
+			}
+			metrics.AddInstructions(executed);
+			latency.Observe(*m_Emulator);
 
-			for (size_t i = 0; i < (size_t)gamespeed; i++)
+			if (!m_Speed.ShouldRender())
 			{
-				t = m_Emulator->GameLoop();
+				//behind on time, the frame is emulated but not drawn
+				metrics.AddSkippedRender();
+				m_Speed.EndFrame();
+				metrics.EndFrame();
+				continue;
 			}
-			
 
-			glClearColor(1.0f, 0.0f, 0.0f, 0.0f);
-			glClear(GL_COLOR_BUFFER_BIT);
+			if (!software)
+			{
+				glClearColor(1.0f, 0.0f, 0.0f, 0.0f);
+				glClear(GL_COLOR_BUFFER_BIT);
+			}
 
-			m_Emulator->Draw();
+			if (runahead > 0 && t)
+			{
+				//show where the game will be a few frames from now with the keys held now,
+				//then roll back so only the real frame counts
+				double start = glfwGetTime();
+				double upload = 0.0;
+				m_Emulator->SaveState(snapshot);
+				m_Emulator->m_Muted = true;
+				int ahead = 0;
+				m_Emulator->RunFor(m_Speed.InstructionsPerFrame() * runahead, ahead);
+				latency.Observe(*m_Emulator);
+				latency.Present(*m_Emulator);
+				upload = glfwGetTime();
+				uploadscreen();
+				upload = glfwGetTime() - upload;
+				m_Emulator->LoadState(snapshot);
+				m_Emulator->m_Muted = false;
+				metrics.AddUploadTime(upload);
+				metrics.AddRunAheadTime(glfwGetTime() - start - upload, runahead);
+			}
+			else
+			{
+				latency.Present(*m_Emulator);
+				double start = glfwGetTime();
+				uploadscreen();
+				metrics.AddUploadTime(glfwGetTime() - start);
+			}
 
-			glDrawArrays(GL_TRIANGLES, 0, 6);
+			if (software)
+			{
+				softwarerenderer.Present();
+				// Nothing waits for a vsync here, sleep out the rest of the frame so it runs at the same pace
+				double wait = glfwGetTime();
+				m_Speed.WaitForFrame();
+				metrics.AddIdleTime(glfwGetTime() - wait);
+			}
+			else
+			{
+				renderer.Present();
 
-			// Swap the screen buffers
-			glfwSwapBuffers(window);
+				// Swap the screen buffers, waiting for the vsync here is the time the emulator is idle
+				double swap = glfwGetTime();
+				glfwSwapBuffers(window);
+				metrics.AddIdleTime(glfwGetTime() - swap);
+			}
+			latency.Swapped();
+			m_Speed.EndFrame();
+			metrics.EndFrame();
 		}
 	}
 
+	//gl objects have to go while the context still exists
+	renderer.Shutdown();
+	softwarerenderer.Shutdown();
+
 	// Terminates GLFW, clearing any resources allocated by GLFW.
 	glfwTerminate();
 
 	return 0;
 }
 
-// Is called whenever a key is pressed/released via GLFW
-void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode)
+//runs many machines at once and shows them all in one grid, a machine that stops keeps showing its last screen
+int RunWall(GLFWwindow* window, int count, const vector<string>& roms, Metrics& metrics)
 {
-	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-		glfwSetWindowShouldClose(window, GL_TRUE);
-}
+	if (roms.empty())
+	{
+		Logger::Log("No roms given for the wall", 0x0C);
+		return 1;
+	}
 
-void OnDragAndDrop(GLFWwindow *wndw, int i, const char **path)
-{
-	string t = string(*path);
-	if (m_Emulator->LoadGame(t), Initialize(wndw))
+	vector<unique_ptr<Chip8>> machines;
+	vector<Chip8*> screens;
+	vector<bool> running;
+	for (int i = 0; i < count; i++)
 	{
-		cout << "Loaded file " << *path << endl;
-		Logger::getInstance()->Log("Loaded file");
+		machines.push_back(unique_ptr<Chip8>(new Chip8(window)));
+		machines.back()->m_Muted = true;
+		running.push_back(machines.back()->LoadGame(roms[i % roms.size()]));
+		screens.push_back(machines.back().get());
 	}
 
-	glfwSetWindowTitle(wndw, t.substr(t.find_last_of('\\')+1, t.find_last_of('.') - t.find_last_of('\\')).c_str()-1);
-	//system("pause");
-}
+	//tiles are as wide as the super-chip screen, the window follows the grid
+	MonitorView view(count);
+	int height = WIDTH * view.GetRows() * MonitorView::TILE_HEIGHT / (view.GetColumns() * MonitorView::TILE_WIDTH);
+	glfwSetWindowSize(window, WIDTH, height);
+	glViewport(0, 0, WIDTH, height);
+	if (!view.Initialize())
+	{
+		Logger::Log("Could not build the wall shaders", 0x0C);
+		return 1;
+	}
 
-bool Initialize(GLFWwindow *wndw)
-{
-	////////////Make the triangle
+	while (!glfwWindowShouldClose(window))
+	{
+		glfwPollEvents();
+
+		//every instance plays with the same keys
+		machines[0]->PollKeys();
+		int owed = m_Speed.BeginFrame();
+		//stopped and waiting machines run fewer than they were owed
+		int total = 0;
+		for (int i = 0; i < count; i++)
+		{
+			machines[i]->m_Keys = machines[0]->m_Keys;
+			int executed = 0;
+			if (running[i])
+			{
+				running[i] = !Stops(machines[i]->RunFor(owed, executed));
+			}
+			total += executed;
+		}
+		metrics.AddInstructions(total);
+
+		double start = glfwGetTime();
+		view.Update(screens);
+		metrics.AddUploadTime(glfwGetTime() - start);
 
-	//every time you call vertexattributepointer the information will be put in the vao
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		view.Present();
+
+		double swap = glfwGetTime();
+		glfwSwapBuffers(window);
+		metrics.AddIdleTime(glfwGetTime() - swap);
+		m_Speed.EndFrame();
+		metrics.EndFrame();
+	}
+
+	view.Shutdown();
+	return 0;
+}
 
-	//vertice list
-	float vertices[] = {
-		//2d pos		//uv coords		//color
-		 1.0f, -1.0f,	1.0f,1.0f,		1.0f,1.0f,1.0f,//C
-		 1.0f,  1.0f,	1.0f,0.0f,		1.0f,1.0f,1.0f,//B
-		-1.0f, -1.0f,	0.0f,1.0f,		1.0f,1.0f,1.0f,//D
+//draws the same rom for a fixed amount of frames with and without the phosphor pass and reports what a frame costs,
+//run it with LIBGL_ALWAYS_SOFTWARE=1 to measure on llvmpipe
+int RunBenchmark(GLFWwindow* window, Renderer& renderer, int frames, const string& gamepath)
+{
+	glfwSwapInterval(0);
+	float decays[] = { 0.0f, renderer.GetPersistence() > 0.0f ? renderer.GetPersistence() : 0.8f };
+	for (float decay : decays)
+	{
+		Chip8 machine(window);
+		machine.m_Muted = true;
+		if (!machine.LoadGame(gamepath.empty() ? "Chip-8_Pack/Chip-8 Demos/Maze (alt) [David Winter, 199x].ch8" : gamepath))
+		{
+			return 1;
+		}
+		renderer.SetPersistence(decay);
 
-		-1.0f, -1.0f,	0.0f,1.0f,		1.0f,1.0f,1.0f,//D
-		-1.0f,  1.0f,	0.0f,0.0f,		1.0f,1.0f,1.0f,//A
-		 1.0f,  1.0f,	1.0f,0.0f,		1.0f,1.0f,1.0f //B
+		double upload = 0.0;
+		double start = glfwGetTime();
+		for (int frame = 0; frame < frames && !glfwWindowShouldClose(window); frame++)
+		{
+			glfwPollEvents();
+			int executed = 0;
+			machine.RunFor(m_Speed.InstructionsPerFrame(), executed);
+			double uploadstart = glfwGetTime();
+			renderer.Upload(machine);
+			upload += glfwGetTime() - uploadstart;
 
-	};
+			glClear(GL_COLOR_BUFFER_BIT);
+			renderer.Present();
+			glfwSwapBuffers(window);
+		}
+		//wait for the gpu so queued frames are counted as well
+		glFinish();
+		double total = glfwGetTime() - start;
+
+		std::stringstream stream;
+		stream << (decay > 0.0f ? "persistence " : "plain ") << std::fixed << std::setprecision(3)
+			<< total * 1000.0 / frames << " ms/frame, upload " << upload * 1000000.0 / frames << " us/frame"
+			<< " (" << (const char*)glGetString(GL_RENDERER) << ")";
+		Logger::Log(stream.str());
+	}
+	return 0;
+}
 
-	//get the vertex buffer
-	GLuint vbo;
-	glGenBuffers(1, &vbo); // Generate 1 buffer
+//the same run as RunBenchmark through the software renderer, so the two can be compared on one machine.
+//upload is the expansion of the screen on the cpu, the rest of a frame is emulating and presenting
+int RunSoftwareBenchmark(GLFWwindow* window, SoftwareRenderer& renderer, int frames, const string& gamepath, const string& target)
+{
+	Chip8 machine(window);
+	machine.m_Muted = true;
+	if (!machine.LoadGame(gamepath.empty() ? "Chip-8_Pack/Chip-8 Demos/Maze (alt) [David Winter, 199x].ch8" : gamepath))
+	{
+		return 1;
+	}
 
-						   //to upload data to your vertex bufffer on the grafics card you have o set it active
-						   //set vbo the active vertex buffer
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	double upload = 0.0;
+	double start = glfwGetTime();
+	for (int frame = 0; frame < frames && !glfwWindowShouldClose(window); frame++)
+	{
+		glfwPollEvents();
+		int executed = 0;
+		machine.RunFor(m_Speed.InstructionsPerFrame(), executed);
+		double uploadstart = glfwGetTime();
+		renderer.Upload(machine);
+		upload += glfwGetTime() - uploadstart;
+		renderer.Present();
+	}
+	double total = glfwGetTime() - start;
 
-	//copy your vertex data to the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	std::stringstream stream;
+	stream << "software " << std::fixed << std::setprecision(3) << total * 1000.0 / frames << " ms/frame, upload "
+		<< upload * 1000000.0 / frames << " us/frame (" << renderer.GetFrameWidth() << "x" << renderer.GetFrameHeight() << " to " << target << ")";
+	Logger::Log(stream.str());
+	return 0;
+}
 
-	/////////////compile the vertex shader
+// Is called whenever a key is pressed/released via GLFW
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode)
+{
+	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+		glfwSetWindowShouldClose(window, GL_TRUE);
 
-	//make a shader object and load the shader in it
-	//see the top for the shader
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexSource, NULL);
+	//up and down move the target rate in 10% steps
+	if (key == GLFW_KEY_UP && action == GLFW_PRESS)
+		m_Speed.SetTarget(m_Speed.GetTarget() * 1.1);
+	if (key == GLFW_KEY_DOWN && action == GLFW_PRESS)
+		m_Speed.SetTarget(m_Speed.GetTarget() / 1.1);
+}
 
-	//compile the shader
-	glCompileShader(vertexShader);
+void OnDragAndDrop(GLFWwindow *wndw, int i, const char **path)
+{
+	//reading the file happens on the loader thread, the game keeps running until it is ready
+	m_Loader->Request(string(*path));
+}
 
-	GLint status;
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-	if (status != GL_TRUE)
+void SetTitle(GLFWwindow *wndw, const string& path)
+{
+	//only the file name, without folders and extension
+	size_t start = path.find_last_of("\\/");
+	start = (start == string::npos) ? 0 : start + 1;
+	size_t end = path.find_last_of('.');
+	if (end == string::npos || end < start)
 	{
-		return false;
+		end = path.size();
 	}
-	/////////////same for the fragment shader
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
-	glCompileShader(fragmentShader);
-
-
-	//combine the two shaders into a program
-	GLuint shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-
-	//specify which fragment shader output is written to which buffer
-	glBindFragDataLocation(shaderProgram, 0, "outColor");
-
-	//link the shader programm
-	glLinkProgram(shaderProgram);
-	//start using the shader programm
-	glUseProgram(shaderProgram);
-
-	//link the vertex data to the shader
-	GLint posAttrib = glGetAttribLocation(shaderProgram, "position");
-	// specify how the data for that input is retrieved from the array
-	glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(float), 0);
-	glEnableVertexAttribArray(posAttrib);
-
-	//link the vertex data to the shader
-	GLint UvAttrib = glGetAttribLocation(shaderProgram, "texcoord");
-	// specify how the data for that input is retrieved from the array
-	glVertexAttribPointer(UvAttrib, 2, GL_FLOAT, GL_FALSE,7*sizeof(float), (void*)(2 * sizeof(float)));
-	glEnableVertexAttribArray(UvAttrib);
-
-	//link the vertex data to the shader
-	GLint ColorAttrib = glGetAttribLocation(shaderProgram, "inColor");
-	// specify how the data for that input is retrieved from the array
-	glVertexAttribPointer(ColorAttrib, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(4 * sizeof(float)));
-	glEnableVertexAttribArray(ColorAttrib);
-
-	//textures
-	GLuint tex;
-	glGenTextures(1, &tex);
-	glBindTexture(GL_TEXTURE_2D, tex);
-	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glfwSetDropCallback(wndw, OnDragAndDrop);
-
-	return true;
+	glfwSetWindowTitle(wndw, path.substr(start, end - start).c_str());
 }
-
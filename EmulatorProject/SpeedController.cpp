@@ -0,0 +1,74 @@
+#include "SpeedController.h"
+#include <algorithm>
+#include <thread>
+
+void SpeedController::SetTarget(double instructionsPerSecond)
+{
+	//below one instruction per frame games stop responding altogether
+	m_Target = max(instructionsPerSecond, (double)FRAMES_PER_SECOND);
+}
+
+int SpeedController::InstructionsPerFrame() const
+{
+	return max(1, (int)(m_Target / FRAMES_PER_SECOND));
+}
+
+int SpeedController::BeginFrame()
+{
+	m_FrameStart = chrono::steady_clock::now();
+	if (!m_Started)
+	{
+		m_Started = true;
+		m_LastFrameStart = m_FrameStart;
+		m_FrameTime = 1.0 / FRAMES_PER_SECOND;
+	}
+	else
+	{
+		m_FrameTime = chrono::duration<double>(m_FrameStart - m_LastFrameStart).count();
+		m_LastFrameStart = m_FrameStart;
+	}
+
+	//owe instructions for the wall time that passed, so slow frames catch up instead of slowing the game,
+	//but a stall of the whole process (debugger, window drag) is not made up for
+	m_Owed += m_Target * min(m_FrameTime, 0.25);
+	int instructions = (int)m_Owed;
+	m_Owed -= instructions;
+	return instructions;
+}
+
+bool SpeedController::HasTime() const
+{
+	double spent = chrono::duration<double>(chrono::steady_clock::now() - m_FrameStart).count();
+	return spent < 1.0 / FRAMES_PER_SECOND;
+}
+
+bool SpeedController::ShouldRender()
+{
+	if (IsTurbo())
+	{
+		return m_Frame % m_RenderEvery == 0;
+	}
+
+	//the last frame overran its vsync, skip drawing this one so emulation keeps its pace,
+	//but never so many in a row that the screen looks frozen
+	if (m_FrameTime > 1.5 / FRAMES_PER_SECOND && m_SkippedRenders < MAX_SKIPPED_RENDERS)
+	{
+		++m_SkippedRenders;
+		return false;
+	}
+	m_SkippedRenders = 0;
+	return true;
+}
+
+void SpeedController::WaitForFrame() const
+{
+	if (!IsTurbo())
+	{
+		this_thread::sleep_until(m_FrameStart + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / FRAMES_PER_SECOND)));
+	}
+}
+
+void SpeedController::EndFrame()
+{
+	++m_Frame;
+}
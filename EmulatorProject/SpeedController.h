@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+
+using namespace std;
+
+//decides how many instructions each frame runs so the emulator holds a target instruction rate,
+//and which frames get drawn when the host cannot keep up
+class SpeedController
+{
+public:
+	static const int FRAMES_PER_SECOND = 60;
+
+	SpeedController(double instructionsPerSecond = 300.0) : m_Target(instructionsPerSecond) {};
+
+	void SetTarget(double instructionsPerSecond);
+	double GetTarget() const { return m_Target; }
+	//turbo runs uncapped and only draws every renderEvery'th frame, 0 turns it off
+	void SetTurbo(int renderEvery) { m_RenderEvery = renderEvery; }
+	bool IsTurbo() const { return m_RenderEvery > 0; }
+	//instructions in one 60 Hz frame at the target rate, used for run-ahead
+	int InstructionsPerFrame() const;
+
+	//starts a frame and returns how many instructions it owes to stay on the target rate
+	int BeginFrame();
+	//turbo keeps emulating until the frames time slice is spent
+	bool HasTime() const;
+	//false when drawing this frame would put the emulator further behind
+	bool ShouldRender();
+	//sleeps until the frame's 1/60 s slice is over, for presenting without a vsync to wait on. nothing in turbo
+	void WaitForFrame() const;
+	void EndFrame();
+
+private:
+	static const int MAX_SKIPPED_RENDERS = 3;
+
+	double m_Target;
+	int m_RenderEvery = 0;
+	double m_Owed = 0.0; //fractional instructions carried to the next frame
+	double m_FrameTime = 0.0;
+	int m_Frame = 0;
+	int m_SkippedRenders = 0;
+	bool m_Started = false;
+	chrono::steady_clock::time_point m_FrameStart;
+	chrono::steady_clock::time_point m_LastFrameStart;
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <winsock2.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+//sockaddr_un as afunix.h defines it, the 8.1 sdk does not ship that header
+struct UnixAddress
+{
+	ADDRESS_FAMILY sun_family;
+	char sun_path[108];
+};
+
+//winsock has to be started once before the first socket call
+inline bool StartWinsock()
+{
+	static bool started = false;
+	if (!started)
+	{
+		WSADATA data;
+		started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}
+	return started;
+}
@@ -0,0 +1,292 @@
+#include "Verifier.h"
+#include "Headless.h"
+#include "Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <sstream>
+#include <iomanip>
+
+//both machines start from the same generator state so CXNN draws the same numbers
+static const U32 SEED = 0x2C8;
+
+static const char* ReasonName(ExitReason reason)
+{
+	switch (reason)
+	{
+	case EXIT_FRAME: return "frame";
+	case EXIT_WAITING_FOR_KEY: return "waiting for a key";
+	case EXIT_BREAKPOINT: return "breakpoint";
+	case EXIT_UNKNOWN_OPCODE: return "unknown opcode";
+	case EXIT_OUT_OF_RANGE: return "out of range";
+	case EXIT_STOPPED: return "stopped";
+	}
+	return "?";
+}
+
+bool Verifier::Run(const vector<string>& paths)
+{
+	vector<string> roms = HeadlessRunner::Expand(paths);
+	vector<Result> results(roms.size());
+
+	atomic<size_t> next(0);
+	auto worker = [&]()
+	{
+		size_t i;
+		while ((i = next++) < roms.size())
+		{
+			results[i] = Verify(roms[i]);
+		}
+	};
+
+	int threadcount = max(1, (int)thread::hardware_concurrency());
+	vector<thread> workers;
+	for (int t = 0; t < threadcount; t++)
+	{
+		workers.push_back(thread(worker));
+	}
+	for (thread& w : workers)
+	{
+		w.join();
+	}
+
+	//in the order the roms were given, a mismatch is followed by its report
+	bool passed = true;
+	for (size_t i = 0; i < roms.size(); i++)
+	{
+		std::stringstream stream;
+		if (!results[i].m_Loaded)
+		{
+			Logger::Log("could not load " + roms[i], 0x0C);
+			passed = false;
+		}
+		else if (results[i].m_Matched)
+		{
+			stream << "same " << std::dec << results[i].m_Instructions << " instructions " << roms[i];
+			Logger::Log(stream.str());
+		}
+		else
+		{
+			stream << "different after " << std::dec << results[i].m_Instructions << " instructions " << roms[i];
+			Logger::Log(stream.str(), 0x0C);
+			Logger::Log(results[i].m_Report);
+			passed = false;
+		}
+	}
+	return passed;
+}
+
+U64 Verifier::StateHash(const Chip8& machine)
+{
+	U64 hash = machine.StateHash();
+	auto add = [&hash](U64 value)
+	{
+		hash ^= value;
+		hash *= 1099511628211ULL;
+	};
+	add(machine.m_MemoryTop);
+	add(machine.m_Pitch);
+	for (int i = 0; i < 16; i++)
+	{
+		add(machine.m_Flags[i] | machine.m_AudioPattern[i] << 8);
+	}
+	return hash;
+}
+
+U16 Verifier::KeysAt(long long frame)
+{
+	//a key is held for 16 frames, then the next one or none
+	U32 mixed = (U32)(frame / 16) * 2654435761u;
+	mixed ^= mixed >> 15;
+	return ((mixed >> 8) & 3) == 0 ? 0 : (U16)(1 << (mixed & 0xF));
+}
+
+int Verifier::Advance(Chip8& machine, Decoder* decoder, long long first, int count, bool& running) const
+{
+	int executed = 0;
+	for (; executed < count && running; executed++)
+	{
+		long long instruction = first + executed;
+		if (executed == 0 || instruction % m_InstructionsPerFrame == 0)
+		{
+			machine.m_Keys = KeysAt(instruction / m_InstructionsPerFrame);
+		}
+		running = decoder ? decoder->Step(machine) : machine.GameLoop();
+	}
+	return executed;
+}
+
+Verifier::Result Verifier::Verify(const string& rom) const
+{
+	Result result;
+	Chip8 reference(nullptr);
+	Chip8 candidate(nullptr);
+	reference.m_Muted = true;
+	candidate.m_Muted = true;
+	if (!reference.LoadGame(rom))
+	{
+		return result;
+	}
+	result.m_Loaded = true;
+	candidate.LoadRom(reference.m_Rom.data(), reference.m_Rom.size());
+	reference.m_Random = SEED;
+	candidate.m_Random = SEED;
+
+	//runs one frame on both engines the way the emulator does, true while they agree after it
+	Decoder decoder;
+	ExitReason referenceReason = EXIT_FRAME;
+	ExitReason candidateReason = EXIT_FRAME;
+	int referenceExecuted = 0;
+	int candidateExecuted = 0;
+	auto frameAgrees = [&](long long frame)
+	{
+		reference.m_Keys = KeysAt(frame);
+		candidate.m_Keys = reference.m_Keys;
+		referenceReason = reference.RunFor(m_InstructionsPerFrame, referenceExecuted);
+		candidateReason = decoder.RunFor(candidate, m_InstructionsPerFrame, candidateExecuted);
+		return referenceExecuted == candidateExecuted && referenceReason == candidateReason &&
+			StateHash(reference) == StateHash(candidate);
+	};
+
+	//checkpoints fall on frame boundaries, the interval is rounded down to whole frames
+	int interval = max(1, m_Interval / m_InstructionsPerFrame);
+	Chip8State checkpoint;
+	long long frame = 0;
+	bool running = true;
+	while (frame < m_Frames && running)
+	{
+		reference.SaveState(checkpoint);
+		long long first = frame;
+		long long last = min(frame + interval, (long long)m_Frames);
+		bool agreed = true;
+		for (; frame < last && running; frame++)
+		{
+			if (!frameAgrees(frame))
+			{
+				agreed = false;
+				break;
+			}
+			result.m_Instructions += referenceExecuted;
+			running = !Stops(referenceReason);
+		}
+		if (agreed)
+		{
+			continue;
+		}
+
+		//back to the checkpoint and on to the start of the frame that went apart, the frames before it agreed
+		reference.LoadState(checkpoint);
+		candidate.LoadState(checkpoint);
+		for (long long f = first; f < frame; f++)
+		{
+			frameAgrees(f);
+		}
+		Chip8State start;
+		reference.SaveState(start);
+		long long firstInstruction = frame * m_InstructionsPerFrame;
+
+		//steps both from the start of the frame and tells whether they still agree after steps instructions
+		auto differs = [&](int steps, bool restore)
+		{
+			if (restore)
+			{
+				reference.LoadState(start);
+				candidate.LoadState(start);
+			}
+			bool referenceRunning = true;
+			bool candidateRunning = true;
+			int executed = Advance(reference, nullptr, firstInstruction, steps, referenceRunning);
+			int stepped = Advance(candidate, &decoder, firstInstruction, steps, candidateRunning);
+			return executed != stepped || referenceRunning != candidateRunning || StateHash(reference) != StateHash(candidate);
+		};
+
+		std::stringstream report;
+		if (differs(m_InstructionsPerFrame, true))
+		{
+			//they agree after low instructions and not after high ones, the instruction after low is the culprit
+			int low = 0;
+			int high = m_InstructionsPerFrame;
+			while (high - low > 1)
+			{
+				int middle = (low + high) / 2;
+				(differs(middle, true) ? high : low) = middle;
+			}
+			differs(low, true);
+			result.m_Instructions += low;
+			report << "before, the same for both\n" << Describe(reference) << "\n" << Listing(reference);
+			differs(1, false);
+			result.m_Instructions += 1;
+			report << "after, reference\n" << Describe(reference) << "\nafter, predecoded\n" << Describe(candidate);
+		}
+		else
+		{
+			//one instruction at a time they agree, so one of the batched loops went wrong. the stepped
+			//reference shows which: timers owed, the waiting shortcuts or the reason the frame ended
+			string stepped = Describe(reference);
+			reference.LoadState(start);
+			candidate.LoadState(start);
+			report << "before, the same for both\n" << Describe(reference) << "\n" << Listing(reference);
+			frameAgrees(frame);
+			report << "only different when run a frame at a time\nafter, reference " << ReasonName(referenceReason) << " after "
+				<< std::dec << referenceExecuted << "\n" << Describe(reference) << "\nafter, predecoded " << ReasonName(candidateReason)
+				<< " after " << std::dec << candidateExecuted << "\n" << Describe(candidate) << "\nafter, stepped\n" << stepped;
+		}
+
+		//memory is too big to print, only where the two went apart
+		int shown = 0;
+		for (int address = 0; address < 0x10000 && shown < 16; address++)
+		{
+			if (reference.m_Memory[address] != candidate.m_Memory[address])
+			{
+				report << "\nmem " << std::hex << std::setfill('0') << std::setw(4) << address << " "
+					<< std::setw(2) << (int)reference.m_Memory[address] << " " << std::setw(2) << (int)candidate.m_Memory[address];
+				++shown;
+			}
+		}
+		if (reference.m_ScreenBuffer != candidate.m_ScreenBuffer)
+		{
+			report << "\nscreen differs";
+		}
+		result.m_Matched = false;
+		result.m_Report = report.str();
+		break;
+	}
+	return result;
+}
+
+string Verifier::Describe(const Chip8& machine)
+{
+	std::stringstream out;
+	out << std::hex << std::setfill('0') << "pc " << std::setw(4) << machine.m_ProgramCounter << " i " << std::setw(4) << machine.m_IndexRegister
+		<< " sp " << (int)machine.m_StackPointer << " dt " << std::setw(2) << (int)machine.m_DelayTimer
+		<< " st " << std::setw(2) << (int)machine.m_SoundTimer << " keys " << std::setw(4) << machine.m_Keys
+		<< " random " << std::setw(8) << machine.m_Random << " top " << std::setw(4) << machine.m_MemoryTop
+		<< " mode " << (machine.m_ExtendedMode ? "128x64" : machine.hiresmode ? "64x64" : "64x32")
+		<< " planes " << (int)machine.m_Planes << "\nv";
+	for (U8 reg : machine.m_Registers)
+	{
+		out << " " << std::setw(2) << (int)reg;
+	}
+	out << "\nstack";
+	for (int i = 0; i < machine.m_StackPointer; i++)
+	{
+		out << " " << std::setw(4) << machine.m_Stack[i];
+	}
+	return out.str();
+}
+
+string Verifier::Listing(const Chip8& machine)
+{
+	//eight instructions either side, the arrow is the one that went wrong
+	std::stringstream out;
+	out << std::hex << std::uppercase << std::setfill('0');
+	int pc = machine.m_ProgramCounter;
+	for (int address = max(pc - 16, 0); address <= min(pc + 16, 0xFFFC); address += 2)
+	{
+		U16 opcode = machine.m_Memory[address] << 8 | machine.m_Memory[address + 1];
+		U16 next = machine.m_Memory[address + 2] << 8 | machine.m_Memory[address + 3];
+		out << (address == pc ? "-> " : "   ") << std::setw(4) << address << "  " << std::setw(4) << opcode
+			<< "  " << Opcodes::Disassemble(opcode, next) << "\n";
+	}
+	return out.str();
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "Chip8.h"
+#include "Decoder.h"
+
+using namespace std;
+
+//runs the predecoded engine in lockstep with the RunCommand interpreter on the same rom, seed and keys,
+//a frame at a time through RunFor like the emulator, comparing the exit reason and the whole machine state
+//after every frame. when they differ the frame is stepped again one instruction at a time and bisected down to
+//the one where they went apart, and both states are printed with the code around it. when they only differ
+//in frames, the batched loops themselves are at fault and both are printed next to the stepped state.
+//every rom of a pack gets its own pair of machines, spread over all cores like -batch
+class Verifier
+{
+public:
+	Verifier(int frames, int interval = 1000, int instructionsPerFrame = 5)
+		: m_Frames(frames), m_Interval(max(interval, 1)), m_InstructionsPerFrame(instructionsPerFrame) {};
+
+	//false when any rom could not be loaded or the engines did not agree on it
+	bool Run(const vector<string>& paths);
+
+	//everything that can differ between two engines, Chip8::StateHash and the cold state it leaves out
+	static U64 StateHash(const Chip8& machine);
+
+private:
+	struct Result
+	{
+		bool m_Loaded = false;
+		bool m_Matched = true;
+		long long m_Instructions = 0;
+		string m_Report;
+	};
+
+	Result Verify(const string& rom) const;
+	//steps up to count instructions of one engine, the reference when there is no decoder,
+	//with the keys the input stream holds from instruction first on. only for narrowing down a mismatch
+	int Advance(Chip8& machine, Decoder* decoder, long long first, int count, bool& running) const;
+	//the keys held during a frame, the same made up sequence for both engines
+	static U16 KeysAt(long long frame);
+	static string Describe(const Chip8& machine);
+	static string Listing(const Chip8& machine);
+
+	int m_Frames;
+	int m_Interval;
+	int m_InstructionsPerFrame;
+};